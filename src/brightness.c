@@ -20,7 +20,6 @@
  */
 
 #include "brightness.h"
-#include "dbus-repowerd.h"
 
 #include <gio/gio.h>
 
@@ -48,7 +47,8 @@ typedef struct
 
   GSettings * settings;
 
-  DbusRepowerd * powerd_proxy;
+  guint powerd_name_tag;
+  guint powerd_subscription;
   char * powerd_name_owner;
 
   double percentage;
@@ -140,10 +140,16 @@ my_dispose(GObject * o)
       g_clear_object(&p->cancellable);
     }
 
-  if (p->powerd_proxy != NULL)
+  if (p->powerd_name_tag != 0)
     {
-      g_signal_handlers_disconnect_by_data(p->powerd_proxy, o);
-      g_clear_object(&p->powerd_proxy);
+      g_bus_unwatch_name(p->powerd_name_tag);
+      p->powerd_name_tag = 0;
+    }
+
+  if (p->powerd_subscription != 0)
+    {
+      g_dbus_connection_signal_unsubscribe(p->system_bus, p->powerd_subscription);
+      p->powerd_subscription = 0;
     }
 
   g_clear_object(&p->settings);
@@ -209,28 +215,32 @@ percentage_to_brightness(IndicatorPowerBrightness * self, double percentage)
 static void set_brightness_global(IndicatorPowerBrightness*, int);
 static void set_brightness_local(IndicatorPowerBrightness*, int);
 
+#define POWERD_NAME "com.lomiri.Repowerd"
+#define POWERD_PATH "/com/lomiri/Repowerd"
+#define POWERD_INTERFACE "com.lomiri.Repowerd"
+
 static void
-on_powerd_brightness_params_ready(GObject      * oproxy,
+on_powerd_brightness_params_ready(GObject      * system_bus,
                                   GAsyncResult * res,
                                   gpointer       gself)
 {
   GError * error;
   GVariant * v;
 
-  v = NULL;
   error = NULL;
-  if (dbus_repowerd_call_get_brightness_params_finish(DBUS_REPOWERD(oproxy), &v, res, &error))
+  v = g_dbus_connection_call_finish(G_DBUS_CONNECTION(system_bus), res, &error);
+  if (v != NULL)
     {
       IndicatorPowerBrightness * self = INDICATOR_POWER_BRIGHTNESS(gself);
       priv_t * p = get_priv(self);
       const gboolean old_ab_supported = p->powerd_ab_supported;
 
       p->have_powerd_params = TRUE;
-      g_variant_get(v, "(iiiib)", &p->powerd_dim,
-                                  &p->powerd_min,
-                                  &p->powerd_max,
-                                  &p->powerd_default_value,
-                                  &p->powerd_ab_supported);
+      g_variant_get(v, "((iiiib))", &p->powerd_dim,
+                                    &p->powerd_min,
+                                    &p->powerd_max,
+                                    &p->powerd_default_value,
+                                    &p->powerd_ab_supported);
       g_debug("powerd brightness settings: dim=%d, min=%d, max=%d, default=%d, ab_supported=%d",
               p->powerd_dim,
               p->powerd_min,
@@ -271,70 +281,158 @@ on_powerd_brightness_params_ready(GObject      * oproxy,
 }
 
 static void
-on_powerd_name_owner_changed(GDBusProxy * powerd_proxy,
-                             GParamSpec * pspec         G_GNUC_UNUSED,
-                             gpointer     gself)
+on_powerd_name_appeared(GDBusConnection * system_bus,
+                        const gchar     * name        G_GNUC_UNUSED,
+                        const gchar     * owner,
+                        gpointer          gself)
 {
   priv_t * p = get_priv(INDICATOR_POWER_BRIGHTNESS(gself));
-  gchar * owner = g_dbus_proxy_get_name_owner(powerd_proxy);
 
   if (g_strcmp0(p->powerd_name_owner, owner))
     {
       p->have_powerd_params = FALSE;
 
-      if (owner != NULL)
-        {
-          dbus_repowerd_call_get_brightness_params(DBUS_REPOWERD(powerd_proxy),
-                                                 p->cancellable,
-                                                 on_powerd_brightness_params_ready,
-                                                 gself);
-        }
+      g_dbus_connection_call(system_bus,
+                             owner,
+                             POWERD_PATH,
+                             POWERD_INTERFACE,
+                             "getBrightnessParams",
+                             NULL,
+                             G_VARIANT_TYPE("((iiiib))"),
+                             G_DBUS_CALL_FLAGS_NONE,
+                             -1,
+                             p->cancellable,
+                             on_powerd_brightness_params_ready,
+                             gself);
 
       g_free(p->powerd_name_owner);
-      p->powerd_name_owner = owner;
-  }
+      p->powerd_name_owner = g_strdup(owner);
+    }
+}
+
+static void
+on_powerd_name_vanished(GDBusConnection * system_bus G_GNUC_UNUSED,
+                        const gchar     * name       G_GNUC_UNUSED,
+                        gpointer          gself)
+{
+  priv_t * p = get_priv(INDICATOR_POWER_BRIGHTNESS(gself));
+
+  p->have_powerd_params = FALSE;
+  g_clear_pointer(&p->powerd_name_owner, g_free);
+}
+
+static void
+on_powerd_brightness_got(GObject      * system_bus,
+                         GAsyncResult * res,
+                         gpointer       gself)
+{
+  GError * error;
+  GVariant * v;
+
+  error = NULL;
+  v = g_dbus_connection_call_finish(G_DBUS_CONNECTION(system_bus), res, &error);
+  if (v != NULL)
+    {
+      GVariant * brightness;
+
+      g_variant_get(v, "(v)", &brightness);
+      if (g_variant_is_of_type(brightness, G_VARIANT_TYPE_INT32))
+        set_brightness_local(gself, g_variant_get_int32(brightness));
+
+      g_variant_unref(brightness);
+      g_variant_unref(v);
+    }
+  else if (error != NULL)
+    {
+      if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning("Unable to get powerd brightness: %s", error->message);
+
+      g_error_free(error);
+    }
 }
 
 static void
-on_powerd_brightness_changed(DbusRepowerd * powerd_proxy,
-                             GParamSpec * pspec         G_GNUC_UNUSED,
-                             gpointer     gself)
+on_powerd_properties_changed(GDBusConnection * system_bus,
+                             const gchar     * sender_name    G_GNUC_UNUSED,
+                             const gchar     * object_path    G_GNUC_UNUSED,
+                             const gchar     * interface_name G_GNUC_UNUSED,
+                             const gchar     * signal_name    G_GNUC_UNUSED,
+                             GVariant        * parameters,
+                             gpointer          gself)
 {
-  set_brightness_local(gself, dbus_repowerd_get_brightness(powerd_proxy));
+  GVariant * changed;
+  const gchar ** invalidated;
+  gint brightness;
+
+  g_variant_get(parameters, "(&s@a{sv}^a&s)", NULL, &changed, &invalidated);
+
+  if (g_variant_lookup(changed, "brightness", "i", &brightness))
+    {
+      set_brightness_local(gself, brightness);
+    }
+  else if (g_strv_contains(invalidated, "brightness"))
+    {
+      g_dbus_connection_call(system_bus,
+                             POWERD_NAME,
+                             POWERD_PATH,
+                             "org.freedesktop.DBus.Properties",
+                             "Get",
+                             g_variant_new("(ss)", POWERD_INTERFACE, "brightness"),
+                             G_VARIANT_TYPE("(v)"),
+                             G_DBUS_CALL_FLAGS_NONE,
+                             -1,
+                             get_priv(gself)->cancellable,
+                             on_powerd_brightness_got,
+                             gself);
+    }
+
+  g_free(invalidated);
+  g_variant_unref(changed);
 }
 
 static void
-on_powerd_proxy_ready(GObject      * source_object G_GNUC_UNUSED,
-                      GAsyncResult * res,
-                      gpointer       gself)
+on_system_bus_ready(GObject      * source_object G_GNUC_UNUSED,
+                    GAsyncResult * res,
+                    gpointer       gself)
 {
   GError * error;
-  DbusRepowerd * powerd_proxy;
+  GDBusConnection * system_bus;
 
   error = NULL;
-  powerd_proxy = dbus_repowerd_proxy_new_for_bus_finish(res, &error);
+  system_bus = g_bus_get_finish(res, &error);
 
-  if (powerd_proxy != NULL)
+  if (system_bus != NULL)
     {
       priv_t * p;
       p = get_priv(INDICATOR_POWER_BRIGHTNESS(gself));
 
       /* keep a handle to the system bus */
       g_clear_object(&p->system_bus);
-      p->system_bus = g_object_ref(g_dbus_proxy_get_connection(G_DBUS_PROXY(powerd_proxy)));
-
-      /* keep the proxy and listen to owner changes */
-      p->powerd_proxy = powerd_proxy;
-      g_signal_connect(p->powerd_proxy, "notify::g-name-owner",
-                       G_CALLBACK(on_powerd_name_owner_changed), gself);
-      g_signal_connect(p->powerd_proxy, "notify::brightness",
-                       G_CALLBACK(on_powerd_brightness_changed), gself);
-      on_powerd_name_owner_changed(G_DBUS_PROXY(powerd_proxy), NULL, gself);
+      p->system_bus = system_bus;
+
+      /* listen to powerd's brightness and owner changes */
+      p->powerd_subscription = g_dbus_connection_signal_subscribe(system_bus,
+                                                                  POWERD_NAME,
+                                                                  "org.freedesktop.DBus.Properties",
+                                                                  "PropertiesChanged",
+                                                                  POWERD_PATH,
+                                                                  POWERD_INTERFACE,
+                                                                  G_DBUS_SIGNAL_FLAGS_NONE,
+                                                                  on_powerd_properties_changed,
+                                                                  gself,
+                                                                  NULL);
+      p->powerd_name_tag = g_bus_watch_name_on_connection(system_bus,
+                                                          POWERD_NAME,
+                                                          G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                                          on_powerd_name_appeared,
+                                                          on_powerd_name_vanished,
+                                                          gself,
+                                                          NULL);
     }
   else if (error != NULL)
     {
       if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_warning("Unable to get powerd proxy: %s", error->message);
+        g_warning("Unable to get system bus: %s", error->message);
 
       g_error_free(error);
     }
@@ -463,13 +561,7 @@ indicator_power_brightness_init(IndicatorPowerBrightness * self)
       g_settings_schema_unref(schema);
     }
 
-  dbus_repowerd_proxy_new_for_bus (G_BUS_TYPE_SYSTEM,
-                                 G_DBUS_PROXY_FLAGS_GET_INVALIDATED_PROPERTIES,
-                                 "com.lomiri.Repowerd",
-                                 "/com/lomiri/Repowerd",
-                                 p->cancellable,
-                                 on_powerd_proxy_ready,
-                                 self);
+  g_bus_get(G_BUS_TYPE_SYSTEM, p->cancellable, on_system_bus_ready, self);
 }
 
 static void
@@ -0,0 +1,384 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dbus-properties.h"
+
+/* the queued changes are kept in a bitmask */
+#define MAX_PROPERTIES 32
+
+struct _IndicatorPowerDBusProperties
+{
+  GDBusNodeInfo * node_info;
+  GDBusInterfaceInfo * interface_info; /* owned by node_info */
+  guint n_properties;
+  GVariant ** values; /* indexed like interface_info->properties */
+  GVariant ** batch_start; /* the values from before the queued changes */
+
+  IndicatorPowerDBusPropertiesChangedFunc changed_func;
+  gpointer user_data;
+
+  GDBusConnection * bus;
+  guint registration_id;
+  gchar * object_path;
+
+  guint32 dirty; /* bit i is set if property i changed since the last flush */
+  guint flush_tag;
+};
+
+/***
+****
+***/
+
+static int
+find_property (const IndicatorPowerDBusProperties * props,
+               const char                         * property_name)
+{
+  guint i;
+
+  for (i=0; i<props->n_properties; ++i)
+    if (!g_strcmp0 (props->interface_info->properties[i]->name, property_name))
+      return (int)i;
+
+  return -1;
+}
+
+static gboolean
+on_flush_idle (gpointer gprops)
+{
+  IndicatorPowerDBusProperties * props = gprops;
+
+  props->flush_tag = 0;
+  indicator_power_dbus_properties_flush (props);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_flush (IndicatorPowerDBusProperties * props)
+{
+  if ((props->flush_tag == 0) && (props->dirty != 0) && (props->registration_id != 0))
+    props->flush_tag = g_idle_add (on_flush_idle, props);
+}
+
+/* Stores @value and queues the change.
+   Returns: TRUE if the value changed */
+static gboolean
+set_value (IndicatorPowerDBusProperties * props,
+           int                            i,
+           GVariant                     * value)
+{
+  const guint32 bit = 1u << i;
+
+  if ((props->values[i] != NULL) && g_variant_equal (props->values[i], value))
+    return FALSE;
+
+  if (props->dirty & bit)
+    g_clear_pointer (&props->values[i], g_variant_unref);
+  else
+    props->batch_start[i] = props->values[i]; /* transfer the ref */
+
+  props->values[i] = g_variant_ref (value);
+  props->dirty |= bit;
+  queue_flush (props);
+
+  return TRUE;
+}
+
+/***
+****  GDBusInterfaceVTable
+***/
+
+static GVariant *
+on_get_property (GDBusConnection * connection     G_GNUC_UNUSED,
+                 const gchar     * sender         G_GNUC_UNUSED,
+                 const gchar     * object_path    G_GNUC_UNUSED,
+                 const gchar     * interface_name G_GNUC_UNUSED,
+                 const gchar     * property_name,
+                 GError         ** error,
+                 gpointer          gprops)
+{
+  IndicatorPowerDBusProperties * props = gprops;
+  const int i = find_property (props, property_name);
+
+  if ((i < 0) || (props->values[i] == NULL))
+    {
+      g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY,
+                   "No value for property '%s'", property_name);
+      return NULL;
+    }
+
+  return g_variant_ref (props->values[i]);
+}
+
+/* GDBus has already checked that the property is writable
+   and that the value has the right type */
+static gboolean
+on_set_property (GDBusConnection * connection     G_GNUC_UNUSED,
+                 const gchar     * sender         G_GNUC_UNUSED,
+                 const gchar     * object_path    G_GNUC_UNUSED,
+                 const gchar     * interface_name G_GNUC_UNUSED,
+                 const gchar     * property_name,
+                 GVariant        * value,
+                 GError         ** error,
+                 gpointer          gprops)
+{
+  IndicatorPowerDBusProperties * props = gprops;
+  const int i = find_property (props, property_name);
+
+  if (i < 0)
+    {
+      g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY,
+                   "No such property '%s'", property_name);
+      return FALSE;
+    }
+
+  if (set_value (props, i, value) && (props->changed_func != NULL))
+    props->changed_func (props, property_name, props->user_data);
+
+  return TRUE;
+}
+
+static const GDBusInterfaceVTable vtable =
+{
+  NULL, /* no methods */
+  on_get_property,
+  on_set_property,
+  { NULL }
+};
+
+/***
+****  Public API
+***/
+
+IndicatorPowerDBusProperties *
+indicator_power_dbus_properties_new (const char                              * introspection_xml,
+                                     IndicatorPowerDBusPropertiesChangedFunc   changed_func,
+                                     gpointer                                  user_data)
+{
+  IndicatorPowerDBusProperties * props;
+  GDBusNodeInfo * node_info;
+  GError * error;
+  guint n;
+
+  error = NULL;
+  node_info = g_dbus_node_info_new_for_xml (introspection_xml, &error);
+  if (node_info == NULL)
+    {
+      g_warning ("Unable to parse D-Bus interface: %s", error->message);
+      g_error_free (error);
+      return NULL;
+    }
+
+  if ((node_info->interfaces == NULL) || (node_info->interfaces[0] == NULL))
+    {
+      g_warning ("No D-Bus interface to export");
+      g_dbus_node_info_unref (node_info);
+      return NULL;
+    }
+
+  n = 0;
+  if (node_info->interfaces[0]->properties != NULL)
+    while (node_info->interfaces[0]->properties[n] != NULL)
+      ++n;
+  g_return_val_if_fail (n <= MAX_PROPERTIES, NULL);
+
+  props = g_new0 (IndicatorPowerDBusProperties, 1);
+  props->node_info = node_info;
+  props->interface_info = node_info->interfaces[0];
+  props->n_properties = n;
+  props->values = g_new0 (GVariant*, n);
+  props->batch_start = g_new0 (GVariant*, n);
+  props->changed_func = changed_func;
+  props->user_data = user_data;
+
+  g_dbus_interface_info_cache_build (props->interface_info);
+
+  return props;
+}
+
+void
+indicator_power_dbus_properties_free (IndicatorPowerDBusProperties * props)
+{
+  guint i;
+
+  if (props == NULL)
+    return;
+
+  indicator_power_dbus_properties_unexport (props);
+
+  for (i=0; i<props->n_properties; ++i)
+    {
+      g_clear_pointer (&props->values[i], g_variant_unref);
+      g_clear_pointer (&props->batch_start[i], g_variant_unref);
+    }
+  g_free (props->values);
+  g_free (props->batch_start);
+
+  g_dbus_interface_info_cache_release (props->interface_info);
+  g_dbus_node_info_unref (props->node_info);
+  g_free (props);
+}
+
+gboolean
+indicator_power_dbus_properties_export (IndicatorPowerDBusProperties * props,
+                                        GDBusConnection              * bus,
+                                        const char                   * object_path,
+                                        GError                      ** error)
+{
+  g_return_val_if_fail (props != NULL, FALSE);
+  g_return_val_if_fail (G_IS_DBUS_CONNECTION (bus), FALSE);
+  g_return_val_if_fail (props->registration_id == 0, FALSE);
+
+  props->registration_id = g_dbus_connection_register_object (bus,
+                                                              object_path,
+                                                              props->interface_info,
+                                                              &vtable,
+                                                              props,
+                                                              NULL,
+                                                              error);
+  if (props->registration_id == 0)
+    return FALSE;
+
+  props->bus = g_object_ref (bus);
+  props->object_path = g_strdup (object_path);
+
+  /* announce anything that changed while we were unexported */
+  queue_flush (props);
+  return TRUE;
+}
+
+void
+indicator_power_dbus_properties_unexport (IndicatorPowerDBusProperties * props)
+{
+  g_return_if_fail (props != NULL);
+
+  if (props->flush_tag != 0)
+    {
+      g_source_remove (props->flush_tag);
+      props->flush_tag = 0;
+    }
+
+  if (props->registration_id != 0)
+    {
+      g_dbus_connection_unregister_object (props->bus, props->registration_id);
+      props->registration_id = 0;
+    }
+
+  g_clear_object (&props->bus);
+  g_clear_pointer (&props->object_path, g_free);
+}
+
+gboolean
+indicator_power_dbus_properties_set (IndicatorPowerDBusProperties * props,
+                                     const char                   * property_name,
+                                     GVariant                     * value)
+{
+  gboolean changed = FALSE;
+  int i;
+
+  g_return_val_if_fail (props != NULL, FALSE);
+  g_return_val_if_fail (value != NULL, FALSE);
+
+  g_variant_ref_sink (value);
+
+  i = find_property (props, property_name);
+  if (i < 0)
+    g_warning ("%s: no such property '%s'", G_STRLOC, property_name);
+  else if (!g_variant_is_of_type (value, G_VARIANT_TYPE (props->interface_info->properties[i]->signature)))
+    g_warning ("%s: '%s' can't be set to a '%s'", G_STRLOC, property_name, g_variant_get_type_string (value));
+  else
+    changed = set_value (props, i, value);
+
+  g_variant_unref (value);
+  return changed;
+}
+
+GVariant *
+indicator_power_dbus_properties_get (const IndicatorPowerDBusProperties * props,
+                                     const char                         * property_name)
+{
+  int i;
+
+  g_return_val_if_fail (props != NULL, NULL);
+
+  i = find_property (props, property_name);
+  g_return_val_if_fail (i >= 0, NULL);
+
+  return props->values[i];
+}
+
+void
+indicator_power_dbus_properties_flush (IndicatorPowerDBusProperties * props)
+{
+  GVariantBuilder changed;
+  gboolean any;
+  GError * error;
+  guint i;
+
+  g_return_if_fail (props != NULL);
+
+  if (props->flush_tag != 0)
+    {
+      g_source_remove (props->flush_tag);
+      props->flush_tag = 0;
+    }
+
+  if ((props->dirty == 0) || (props->registration_id == 0))
+    return;
+
+  /* skip properties that changed and then changed back */
+  any = FALSE;
+  g_variant_builder_init (&changed, G_VARIANT_TYPE_VARDICT);
+  for (i=0; i<props->n_properties; ++i)
+    {
+      if (!(props->dirty & (1u << i)))
+        continue;
+
+      if ((props->batch_start[i] == NULL) || !g_variant_equal (props->batch_start[i], props->values[i]))
+        {
+          g_variant_builder_add (&changed, "{sv}",
+                                 props->interface_info->properties[i]->name,
+                                 props->values[i]);
+          any = TRUE;
+        }
+
+      g_clear_pointer (&props->batch_start[i], g_variant_unref);
+    }
+  props->dirty = 0;
+
+  if (!any)
+    {
+      g_variant_builder_clear (&changed);
+      return;
+    }
+
+  error = NULL;
+  g_dbus_connection_emit_signal (props->bus,
+                                 NULL,
+                                 props->object_path,
+                                 "org.freedesktop.DBus.Properties",
+                                 "PropertiesChanged",
+                                 g_variant_new ("(s@a{sv}@as)",
+                                                props->interface_info->name,
+                                                g_variant_builder_end (&changed),
+                                                g_variant_new_strv (NULL, 0)),
+                                 &error);
+  if (error != NULL)
+    {
+      g_warning ("Unable to emit PropertiesChanged: %s", error->message);
+      g_error_free (error);
+    }
+}
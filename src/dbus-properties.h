@@ -0,0 +1,87 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __INDICATOR_POWER_DBUS_PROPERTIES_H__
+#define __INDICATOR_POWER_DBUS_PROPERTIES_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * A D-Bus interface that has only properties, exported straight from
+ * a GDBusInterfaceVTable over an array of GVariant values.
+ *
+ * Setting a property to a new value queues it, and all the properties
+ * changed before the main loop next goes idle are announced together
+ * in one PropertiesChanged signal.
+ */
+typedef struct _IndicatorPowerDBusProperties IndicatorPowerDBusProperties;
+
+/**
+ * Called after a client has changed @property_name with a Set call
+ */
+typedef void (*IndicatorPowerDBusPropertiesChangedFunc) (IndicatorPowerDBusProperties * props,
+                                                         const char                   * property_name,
+                                                         gpointer                       user_data);
+
+/**
+ * @introspection_xml: a <node> holding the one interface to export.
+ *   Every property should be given a value before it's exported.
+ * @changed_func: called when a client sets one of the writable properties,
+ *   or NULL if there aren't any
+ *
+ * Returns: the new properties, or NULL if @introspection_xml is invalid
+ */
+IndicatorPowerDBusProperties * indicator_power_dbus_properties_new (const char                              * introspection_xml,
+                                                                    IndicatorPowerDBusPropertiesChangedFunc   changed_func,
+                                                                    gpointer                                  user_data);
+
+void indicator_power_dbus_properties_free (IndicatorPowerDBusProperties * props);
+
+gboolean indicator_power_dbus_properties_export (IndicatorPowerDBusProperties * props,
+                                                 GDBusConnection              * bus,
+                                                 const char                   * object_path,
+                                                 GError                      ** error);
+
+/**
+ * Changes made while unexported are announced on the next export.
+ */
+void indicator_power_dbus_properties_unexport (IndicatorPowerDBusProperties * props);
+
+/**
+ * Sets @property_name to @value, consuming @value if it's floating.
+ *
+ * Returns: TRUE if the value changed
+ */
+gboolean indicator_power_dbus_properties_set (IndicatorPowerDBusProperties * props,
+                                              const char                   * property_name,
+                                              GVariant                     * value);
+
+/**
+ * Returns: (transfer none): @property_name's value, or NULL if it's unset
+ */
+GVariant * indicator_power_dbus_properties_get (const IndicatorPowerDBusProperties * props,
+                                                const char                         * property_name);
+
+/**
+ * Emits the queued changes now instead of waiting for the main loop
+ */
+void indicator_power_dbus_properties_flush (IndicatorPowerDBusProperties * props);
+
+G_END_DECLS
+
+#endif /* __INDICATOR_POWER_DBUS_PROPERTIES_H__ */
@@ -55,8 +55,12 @@ static void
 my_dispose (GObject * o)
 {
   IndicatorPowerDeviceProviderMock * self = INDICATOR_POWER_DEVICE_PROVIDER_MOCK(o);
+  GList * l;
 
+  for (l=self->devices; l!=NULL; l=l->next)
+    g_signal_handlers_disconnect_by_data (l->data, self);
   g_list_free_full (self->devices, g_object_unref);
+  self->devices = NULL;
 
   G_OBJECT_CLASS (indicator_power_device_provider_mock_parent_class)->dispose (o);
 }
@@ -104,4 +108,21 @@ indicator_power_device_provider_add_device (IndicatorPowerDeviceProviderMock * p
   provider->devices = g_list_append (provider->devices, g_object_ref(device));
 
   g_signal_connect_swapped (device, "notify", G_CALLBACK(indicator_power_device_provider_emit_devices_changed), provider);
+
+  indicator_power_device_provider_emit_devices_changed (INDICATOR_POWER_DEVICE_PROVIDER (provider));
+}
+
+void
+indicator_power_device_provider_remove_device (IndicatorPowerDeviceProviderMock * provider,
+                                               IndicatorPowerDevice             * device)
+{
+  GList * l = g_list_find (provider->devices, device);
+
+  g_return_if_fail (l != NULL);
+
+  g_signal_handlers_disconnect_by_data (device, provider);
+  provider->devices = g_list_delete_link (provider->devices, l);
+  g_object_unref (device);
+
+  indicator_power_device_provider_emit_devices_changed (INDICATOR_POWER_DEVICE_PROVIDER (provider));
 }
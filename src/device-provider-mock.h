@@ -74,6 +74,9 @@ IndicatorPowerDeviceProvider * indicator_power_device_provider_mock_new (void);
 void indicator_power_device_provider_add_device (IndicatorPowerDeviceProviderMock * provider,
                                                  IndicatorPowerDevice             * device);
 
+void indicator_power_device_provider_remove_device (IndicatorPowerDeviceProviderMock * provider,
+                                                    IndicatorPowerDevice             * device);
+
 G_END_DECLS
 
 #endif /* __INDICATOR_POWER_DEVICE_PROVIDER_MOCK__H__ */
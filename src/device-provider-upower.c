@@ -28,6 +28,19 @@
 
 #define DISPLAY_DEVICE_PATH "/org/freedesktop/UPower/devices/DisplayDevice"
 
+#define SETTINGS_SHOW_POWER_S "show-power"
+#define SETTINGS_DEVICE_RATE_LIMITS_S "device-rate-limits"
+
+/* updates at or below this percentage are never rate-limited,
+   so that the notifier's low-battery warnings aren't delayed */
+#define RATE_LIMIT_BYPASS_PERCENTAGE 10.0
+
+/* EnergyRate is noisy, so it's smoothed with an exponential moving
+   average and only pushed to the device when the average has moved
+   by at least one display step, so that jitter doesn't rebuild menus */
+#define ENERGY_RATE_EMA_ALPHA 0.3
+#define ENERGY_RATE_QUANTUM 0.1
+
 /***
 ****  private struct
 ***/
@@ -49,6 +62,20 @@ typedef struct
   GSList* subscriptions;
 
   guint name_tag;
+
+  GSettings * settings;
+
+  /* EnergyRate is only parsed while the user wants to see it */
+  gboolean energy_rate_enabled;
+
+  /* dbus object path --> gdouble* moving average of its EnergyRate */
+  GHashTable * energy_rates;
+
+  /* struct rate_rule, parsed from the device-rate-limits setting */
+  GArray * rate_rules;
+
+  /* dbus object path --> struct rate_limiter*, or NULL if unlimited */
+  GHashTable * rate_limiters;
 }
 IndicatorPowerDeviceProviderUPowerPrivate;
 
@@ -88,6 +115,44 @@ emit_devices_changed (IndicatorPowerDeviceProviderUPower * self)
   indicator_power_device_provider_emit_devices_changed (INDICATOR_POWER_DEVICE_PROVIDER (self));
 }
 
+/* folds a raw EnergyRate sample into the path's moving average.
+   Some drivers report the rate as negative while charging, so only
+   its magnitude is used. Returns TRUE if the device's displayed rate changed. */
+static gboolean
+update_energy_rate (IndicatorPowerDeviceProviderUPower * self,
+                    IndicatorPowerDevice               * device,
+                    const char                         * path,
+                    gdouble                              sample)
+{
+  priv_t * p = get_priv(self);
+  gdouble * ema;
+  gdouble rate;
+
+  sample = ABS (sample);
+
+  if ((ema = g_hash_table_lookup (p->energy_rates, path)))
+    {
+      *ema += ENERGY_RATE_EMA_ALPHA * (sample - *ema);
+    }
+  else
+    {
+      ema = g_new (gdouble, 1);
+      *ema = sample;
+      g_hash_table_insert (p->energy_rates, g_strdup (path), ema);
+    }
+
+  rate = indicator_power_device_get_energy_rate (device);
+  if (ABS (*ema - rate) < ENERGY_RATE_QUANTUM)
+    return FALSE;
+
+  rate = (gint64)(*ema / ENERGY_RATE_QUANTUM + 0.5) * ENERGY_RATE_QUANTUM;
+  g_object_set (device, INDICATOR_POWER_DEVICE_ENERGY_RATE, rate, NULL);
+  return TRUE;
+}
+
+static void discard_held_back_updates (IndicatorPowerDeviceProviderUPower * self,
+                                       const char                         * object_path);
+
 static void
 on_get_all_response (GObject * o, GAsyncResult * res, gpointer gdata)
 {
@@ -114,6 +179,7 @@ on_get_all_response (GObject * o, GAsyncResult * res, gpointer gdata)
       gint64 time_to_full = 0;
       gint64 time;
       gboolean power_supply = FALSE;
+      gdouble energy_rate = 0;
       IndicatorPowerDevice * device;
       priv_t * p = get_priv(data->self);
       GVariant * dict = g_variant_get_child_value (response, 0);
@@ -125,9 +191,18 @@ on_get_all_response (GObject * o, GAsyncResult * res, gpointer gdata)
       g_variant_lookup (dict, "TimeToFull", "x", &time_to_full);
       g_variant_lookup (dict, "PowerSupply", "b", &power_supply);
       time = time_to_empty ? time_to_empty : time_to_full;
+      if (p->energy_rate_enabled)
+        g_variant_lookup (dict, "EnergyRate", "d", &energy_rate);
+
+      /* these values are newer than anything the rate limiter is holding */
+      discard_held_back_updates (data->self, data->path);
 
       if ((device = g_hash_table_lookup (p->devices, data->path)))
         {
+          /* don't average charging and discharging rates together */
+          if (indicator_power_device_get_state (device) != (UpDeviceState)state)
+            g_hash_table_remove (p->energy_rates, data->path);
+
           g_object_set (device, INDICATOR_POWER_DEVICE_KIND, (gint)kind,
                                 INDICATOR_POWER_DEVICE_STATE, (gint)state,
                                 INDICATOR_POWER_DEVICE_OBJECT_PATH, data->path,
@@ -152,6 +227,9 @@ on_get_all_response (GObject * o, GAsyncResult * res, gpointer gdata)
           g_object_unref (device);
         }
 
+      if (p->energy_rate_enabled)
+        update_energy_rate (data->self, device, data->path, energy_rate);
+
       emit_devices_changed (data->self);
       g_variant_unref (dict);
       g_variant_unref (response);
@@ -281,6 +359,354 @@ on_enumerate_devices_response(GObject       * bus,
   g_clear_pointer(&v, g_variant_unref);
 }
 
+/* applies one changed UPower property to the device.
+   Returns TRUE if the device changed. */
+static gboolean
+apply_device_property(IndicatorPowerDeviceProviderUPower * self,
+                      IndicatorPowerDevice               * device,
+                      const gchar                        * object_path,
+                      const gchar                        * key,
+                      GVariant                           * value)
+{
+  priv_t* p = get_priv(self);
+  gboolean changed = FALSE;
+
+  if (!g_strcmp0(key, "TimeToFull") || !g_strcmp0(key, "TimeToEmpty"))
+    {
+      const gint64 i = g_variant_get_int64(value);
+      if (i != 0)
+        {
+          g_object_set(device,
+                       INDICATOR_POWER_DEVICE_TIME, (guint64)i,
+                       NULL);
+          changed = TRUE;
+        }
+    }
+  else if (!g_strcmp0(key, "Percentage"))
+    {
+      const gdouble d = g_variant_get_double(value);
+      g_object_set(device,
+                   INDICATOR_POWER_DEVICE_PERCENTAGE, d,
+                   NULL);
+      changed = TRUE;
+    }
+  else if (!g_strcmp0(key, "Type"))
+    {
+      const guint32 u = g_variant_get_uint32(value);
+      g_object_set(device,
+                   INDICATOR_POWER_DEVICE_KIND, (gint)u,
+                   NULL);
+      changed = TRUE;
+    }
+  else if (!g_strcmp0(key, "State"))
+    {
+      const guint32 u = g_variant_get_uint32(value);
+      /* don't average charging and discharging rates together */
+      if (indicator_power_device_get_state(device) != (UpDeviceState)u)
+        g_hash_table_remove(p->energy_rates, object_path);
+      g_object_set(device,
+                   INDICATOR_POWER_DEVICE_STATE, (gint)u,
+                   NULL);
+      changed = TRUE;
+    }
+  else if (p->energy_rate_enabled && !g_strcmp0(key, "EnergyRate"))
+    {
+      const gdouble d = g_variant_get_double(value);
+      if (update_energy_rate(self, device, object_path, d))
+        changed = TRUE;
+    }
+
+  return changed;
+}
+
+/***
+****  Rate limiting
+****
+****  Some wireless receivers and Android gauges send PropertiesChanged
+****  several times a second. Devices that match a rule in the
+****  device-rate-limits setting get a token bucket: each update spends
+****  a token, and updates that arrive while the bucket is empty are
+****  folded into one pending update that's applied when a token refills.
+****  State changes and low battery levels are never held back.
+***/
+
+struct rate_rule
+{
+  gchar * pattern; /* a glob for the object path if it starts with '/',
+                      or for the device kind's name otherwise */
+  gdouble rate; /* tokens per second. <= 0 means unlimited */
+  gdouble burst; /* bucket size */
+};
+
+struct rate_limiter
+{
+  IndicatorPowerDeviceProviderUPower * self;
+  gchar * path;
+  gdouble rate;
+  gdouble burst;
+  gdouble tokens;
+  gint64 refilled_at; /* monotonic usec */
+
+  /* property name --> GVariant of the newest value not yet applied */
+  GHashTable * pending;
+  guint flush_tag;
+
+  /* property updates that were superseded before they could be applied */
+  guint drops;
+};
+
+static void
+rate_rule_clear (gpointer grule)
+{
+  struct rate_rule * rule = grule;
+
+  g_free (rule->pattern);
+}
+
+static void
+rate_limiter_free (gpointer gl)
+{
+  struct rate_limiter * l = gl;
+
+  if (l == NULL) /* unlimited devices have no limiter */
+    return;
+
+  if (l->flush_tag != 0)
+    g_source_remove (l->flush_tag);
+
+  g_hash_table_destroy (l->pending);
+  g_free (l->path);
+  g_slice_free (struct rate_limiter, l);
+}
+
+static void
+load_rate_rules (IndicatorPowerDeviceProviderUPower * self)
+{
+  priv_t * p = get_priv(self);
+  GVariant * rules;
+  GVariantIter iter;
+  struct rate_rule rule;
+
+  g_array_set_size (p->rate_rules, 0);
+
+  rules = g_settings_get_value (p->settings, SETTINGS_DEVICE_RATE_LIMITS_S);
+  g_variant_iter_init (&iter, rules);
+  while (g_variant_iter_next (&iter, "(sdd)", &rule.pattern, &rule.rate, &rule.burst))
+    {
+      rule.burst = MAX (rule.burst, 1.0);
+      g_array_append_val (p->rate_rules, rule);
+    }
+  g_variant_unref (rules);
+}
+
+/* returns the device's limiter, or NULL if it isn't rate-limited */
+static struct rate_limiter *
+get_rate_limiter (IndicatorPowerDeviceProviderUPower * self,
+                  IndicatorPowerDevice               * device,
+                  const gchar                        * object_path)
+{
+  priv_t * p = get_priv(self);
+  struct rate_limiter * l = NULL;
+  const char * kind_str;
+  guint i;
+
+  if (g_hash_table_lookup_extended (p->rate_limiters, object_path, NULL, (gpointer*)&l))
+    return l;
+
+  /* first matching rule wins */
+  kind_str = indicator_power_device_kind_to_string (indicator_power_device_get_kind (device));
+  for (i=0; i<p->rate_rules->len; ++i)
+    {
+      const struct rate_rule * rule = &g_array_index (p->rate_rules, struct rate_rule, i);
+      const char * subject = *rule->pattern == '/' ? object_path : kind_str;
+
+      if (g_pattern_match_simple (rule->pattern, subject))
+        {
+          if (rule->rate > 0)
+            {
+              l = g_slice_new0 (struct rate_limiter);
+              l->self = self;
+              l->path = g_strdup (object_path);
+              l->rate = rule->rate;
+              l->burst = rule->burst;
+              l->tokens = rule->burst;
+              l->refilled_at = g_get_monotonic_time ();
+              l->pending = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  g_free, (GDestroyNotify)g_variant_unref);
+            }
+          break;
+        }
+    }
+
+  g_hash_table_insert (p->rate_limiters, g_strdup (object_path), l);
+  return l;
+}
+
+static void
+rate_limiter_refill (struct rate_limiter * l)
+{
+  const gint64 now = g_get_monotonic_time ();
+
+  l->tokens = MIN (l->burst, l->tokens + l->rate * (now - l->refilled_at) / G_USEC_PER_SEC);
+  l->refilled_at = now;
+}
+
+/* applies the limiter's pending update. Returns TRUE if the device changed */
+static gboolean
+rate_limiter_apply_pending (struct rate_limiter * l, IndicatorPowerDevice * device)
+{
+  gboolean changed = FALSE;
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+
+  g_hash_table_iter_init (&iter, l->pending);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    if (apply_device_property (l->self, device, l->path, key, value))
+      changed = TRUE;
+
+  g_hash_table_remove_all (l->pending);
+  return changed;
+}
+
+static gboolean
+on_rate_limiter_flush (gpointer gl)
+{
+  struct rate_limiter * l = gl;
+  priv_t * p = get_priv(l->self);
+  IndicatorPowerDevice * device;
+
+  l->flush_tag = 0;
+
+  rate_limiter_refill (l);
+  l->tokens = MAX (0.0, l->tokens - 1.0);
+
+  if ((device = g_hash_table_lookup (p->devices, l->path)))
+    {
+      g_debug ("%s: applying held-back update (%u dropped so far)", l->path, l->drops);
+
+      if (rate_limiter_apply_pending (l, device))
+        emit_devices_changed (l->self);
+    }
+  else
+    {
+      g_hash_table_remove_all (l->pending);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+discard_held_back_updates (IndicatorPowerDeviceProviderUPower * self,
+                           const char                         * object_path)
+{
+  struct rate_limiter * l = g_hash_table_lookup (get_priv(self)->rate_limiters, object_path);
+
+  if ((l == NULL) || (g_hash_table_size (l->pending) == 0))
+    return;
+
+  if (l->flush_tag != 0)
+    {
+      g_source_remove (l->flush_tag);
+      l->flush_tag = 0;
+    }
+
+  l->drops += g_hash_table_size (l->pending);
+  g_debug ("%s: refreshed, so %u held-back updates were dropped (%u so far)",
+           object_path, g_hash_table_size (l->pending), l->drops);
+  g_hash_table_remove_all (l->pending);
+}
+
+/* state changes and low battery levels must be shown at once */
+static gboolean
+bypasses_rate_limit (IndicatorPowerDevice * device, GVariant * dict)
+{
+  guint32 state;
+  gdouble percentage;
+
+  if (g_variant_lookup (dict, "State", "u", &state) &&
+      ((UpDeviceState)state != indicator_power_device_get_state (device)))
+    return TRUE;
+
+  if (g_variant_lookup (dict, "Percentage", "d", &percentage) &&
+      (percentage <= RATE_LIMIT_BYPASS_PERCENTAGE))
+    return TRUE;
+
+  return FALSE;
+}
+
+/* Applies @dict now if the device has a token to spend;
+   otherwise folds it into the pending update for later.
+   Returns TRUE if the device changed. */
+static gboolean
+rate_limit_device_properties (IndicatorPowerDeviceProviderUPower * self,
+                              IndicatorPowerDevice               * device,
+                              const gchar                        * object_path,
+                              GVariant                           * dict)
+{
+  struct rate_limiter * l;
+  gboolean changed = FALSE;
+  gboolean apply_now;
+  GVariantIter iter;
+  gchar * key;
+  GVariant * value;
+
+  l = get_rate_limiter (self, device, object_path);
+
+  if (l == NULL)
+    {
+      apply_now = TRUE;
+    }
+  else if (bypasses_rate_limit (device, dict))
+    {
+      /* apply whatever's pending too, so nothing older lands later */
+      if (l->flush_tag != 0)
+        {
+          g_source_remove (l->flush_tag);
+          l->flush_tag = 0;
+        }
+      rate_limiter_refill (l);
+      l->tokens = MAX (0.0, l->tokens - 1.0);
+      changed = rate_limiter_apply_pending (l, device);
+      apply_now = TRUE;
+    }
+  else
+    {
+      rate_limiter_refill (l);
+      apply_now = (l->flush_tag == 0) && (l->tokens >= 1.0);
+      if (apply_now)
+        l->tokens -= 1.0;
+    }
+
+  g_variant_iter_init (&iter, dict);
+  while (g_variant_iter_next (&iter, "{sv}", &key, &value))
+    {
+      if (apply_now)
+        {
+          if (apply_device_property (self, device, object_path, key, value))
+            changed = TRUE;
+          g_free (key);
+          g_variant_unref (value);
+        }
+      else
+        {
+          /* a held-back value for this property was superseded */
+          if (g_hash_table_contains (l->pending, key))
+            ++l->drops;
+
+          g_hash_table_replace (l->pending, key, value);
+        }
+    }
+
+  if (!apply_now && (l->flush_tag == 0))
+    {
+      const guint msec = (guint) ((1.0 - l->tokens) * 1000.0 / l->rate) + 1;
+      l->flush_tag = g_timeout_add (msec, on_rate_limiter_flush, l);
+    }
+
+  return changed;
+}
+
 static void
 on_device_properties_changed(GDBusConnection * connection     G_GNUC_UNUSED,
                              const gchar     * sender_name    G_GNUC_UNUSED,
@@ -307,56 +733,14 @@ on_device_properties_changed(GDBusConnection * connection     G_GNUC_UNUSED,
     }
   else if ((parameters != NULL) && g_variant_n_children(parameters)>=2)
     {
-      gboolean changed = FALSE;
       GVariant* dict;
-      GVariantIter iter;
-      gchar* key;
-      GVariant* value;
 
       dict = g_variant_get_child_value(parameters, 1);
-      g_variant_iter_init(&iter, dict);
-      while (g_variant_iter_next(&iter, "{sv}", &key, &value))
-        {
-          if (!g_strcmp0(key, "TimeToFull") || !g_strcmp0(key, "TimeToEmpty"))
-            {
-              const gint64 i = g_variant_get_int64(value);
-              if (i != 0)
-                {
-                  g_object_set(device,
-                               INDICATOR_POWER_DEVICE_TIME, (guint64)i,
-                               NULL);
-                  changed = TRUE;
-                }
-            }
-          else if (!g_strcmp0(key, "Percentage"))
-            {
-              const gdouble d = g_variant_get_double(value);
-              g_object_set(device,
-                           INDICATOR_POWER_DEVICE_PERCENTAGE, d,
-                           NULL);
-              changed = TRUE;
-            }
-          else if (!g_strcmp0(key, "Type"))
-            {
-              const guint32 u = g_variant_get_uint32(value);
-              g_object_set(device,
-                           INDICATOR_POWER_DEVICE_KIND, (gint)u,
-                           NULL);
-              changed = TRUE;
-            }
-          else if (!g_strcmp0(key, "State"))
-            {
-              const guint32 u = g_variant_get_uint32(value);
-              g_object_set(device,
-                           INDICATOR_POWER_DEVICE_STATE, (gint)u,
-                           NULL);
-              changed = TRUE;
-            }
-        }
-      g_variant_unref(dict);
 
-      if (changed)
+      if (rate_limit_device_properties(self, device, object_path, dict))
         emit_devices_changed(self);
+
+      g_variant_unref(dict);
     }
 }
 
@@ -403,6 +787,8 @@ on_upower_signal(GDBusConnection * connection     G_GNUC_UNUSED,
       const char* device_path = get_path_from_nth_child(parameters, 0);
       g_hash_table_remove(p->devices, device_path);
       g_hash_table_remove(p->queued_paths, device_path);
+      g_hash_table_remove(p->energy_rates, device_path);
+      g_hash_table_remove(p->rate_limiters, device_path);
       emit_devices_changed(self);
     }
   else if (!g_strcmp0(signal_name, "DeviceChanged")) /* UPower < 0.99 */
@@ -491,6 +877,8 @@ on_bus_name_vanished(GDBusConnection * connection G_GNUC_UNUSED,
   /* clear the devices */
   g_hash_table_remove_all(p->devices);
   g_hash_table_remove_all(p->queued_paths);
+  g_hash_table_remove_all(p->energy_rates);
+  g_hash_table_remove_all(p->rate_limiters);
   if (p->queued_paths_timer != 0)
     {
       g_source_remove(p->queued_paths_timer);
@@ -508,6 +896,70 @@ on_bus_name_vanished(GDBusConnection * connection G_GNUC_UNUSED,
   g_clear_object(&p->bus);
 }
 
+/***
+****  Settings
+***/
+
+static void
+on_show_power_changed (IndicatorPowerDeviceProviderUPower * self)
+{
+  priv_t * p = get_priv(self);
+  GHashTableIter iter;
+  gpointer path;
+  gpointer device;
+  const gboolean enabled = g_settings_get_boolean (p->settings, SETTINGS_SHOW_POWER_S);
+
+  if (p->energy_rate_enabled == enabled)
+    return;
+
+  p->energy_rate_enabled = enabled;
+
+  if (enabled)
+    {
+      /* fetch everyone's EnergyRate */
+      g_hash_table_iter_init (&iter, p->devices);
+      while (g_hash_table_iter_next (&iter, &path, NULL))
+        refresh_device_soon (self, path);
+    }
+  else
+    {
+      /* forget the rates */
+      g_hash_table_remove_all (p->energy_rates);
+      g_hash_table_iter_init (&iter, p->devices);
+      while (g_hash_table_iter_next (&iter, NULL, &device))
+        g_object_set (device, INDICATOR_POWER_DEVICE_ENERGY_RATE, 0.0, NULL);
+
+      emit_devices_changed (self);
+    }
+}
+
+static void
+on_device_rate_limits_changed (IndicatorPowerDeviceProviderUPower * self)
+{
+  priv_t * p = get_priv(self);
+  GHashTableIter iter;
+  gpointer value;
+  gboolean changed = FALSE;
+
+  /* apply anything held back under the old rules, then start over */
+  g_hash_table_iter_init (&iter, p->rate_limiters);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      struct rate_limiter * l = value;
+      IndicatorPowerDevice * device;
+
+      if ((l != NULL) && (device = g_hash_table_lookup (p->devices, l->path)))
+        if (rate_limiter_apply_pending (l, device))
+          changed = TRUE;
+    }
+
+  g_hash_table_remove_all (p->rate_limiters);
+  load_rate_rules (self);
+
+  if (changed)
+    emit_devices_changed (self);
+}
+
 /***
 ****  IndicatorPowerDeviceProvider virtual functions
 ***/
@@ -562,6 +1014,13 @@ my_dispose (GObject * o)
       p->name_tag = 0;
     }
 
+  if (p->settings != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (p->settings, self);
+
+      g_clear_object (&p->settings);
+    }
+
   G_OBJECT_CLASS (indicator_power_device_provider_upower_parent_class)->dispose(o);
 }
 
@@ -576,6 +1035,9 @@ my_finalize (GObject * o)
 
   g_hash_table_destroy (p->devices);
   g_hash_table_destroy (p->queued_paths);
+  g_hash_table_destroy (p->energy_rates);
+  g_hash_table_destroy (p->rate_limiters);
+  g_array_free (p->rate_rules, TRUE);
 
   G_OBJECT_CLASS (indicator_power_device_provider_upower_parent_class)->finalize (o);
 }
@@ -616,6 +1078,26 @@ indicator_power_device_provider_upower_init (IndicatorPowerDeviceProviderUPower
                                           g_free,
                                           NULL);
 
+  p->energy_rates = g_hash_table_new_full(g_str_hash,
+                                          g_str_equal,
+                                          g_free,
+                                          g_free);
+
+  p->settings = g_settings_new ("org.ayatana.indicator.power");
+  p->energy_rate_enabled = g_settings_get_boolean (p->settings, SETTINGS_SHOW_POWER_S);
+  g_signal_connect_swapped (p->settings, "changed::" SETTINGS_SHOW_POWER_S,
+                            G_CALLBACK(on_show_power_changed), self);
+
+  p->rate_rules = g_array_new (FALSE, FALSE, sizeof(struct rate_rule));
+  g_array_set_clear_func (p->rate_rules, rate_rule_clear);
+  p->rate_limiters = g_hash_table_new_full(g_str_hash,
+                                           g_str_equal,
+                                           g_free,
+                                           rate_limiter_free);
+  load_rate_rules (self);
+  g_signal_connect_swapped (p->settings, "changed::" SETTINGS_DEVICE_RATE_LIMITS_S,
+                            G_CALLBACK(on_device_rate_limits_changed), self);
+
   p->name_tag = g_bus_watch_name(G_BUS_TYPE_SYSTEM,
                                  BUS_NAME,
                                  G_BUS_NAME_WATCHER_FLAGS_NONE,
@@ -636,3 +1118,15 @@ indicator_power_device_provider_upower_new(void)
 
   return INDICATOR_POWER_DEVICE_PROVIDER (o);
 }
+
+guint
+indicator_power_device_provider_upower_get_drop_count (IndicatorPowerDeviceProviderUPower * self,
+                                                        const char                         * object_path)
+{
+  const struct rate_limiter * l;
+
+  g_return_val_if_fail (INDICATOR_IS_POWER_DEVICE_PROVIDER_UPOWER (self), 0);
+
+  l = g_hash_table_lookup (get_priv(self)->rate_limiters, object_path);
+  return l != NULL ? l->drops : 0;
+}
@@ -65,6 +65,15 @@ GType indicator_power_device_provider_upower_get_type (void);
 
 IndicatorPowerDeviceProvider * indicator_power_device_provider_upower_new (void);
 
+/**
+ * For diagnostics: how many of the device's property updates were
+ * superseded, by a newer value or a refresh, while held back by its
+ * rate limiter. See the device-rate-limits setting. The service also
+ * publishes these as the Diagnostics interface's RateLimitDrops.
+ */
+guint indicator_power_device_provider_upower_get_drop_count (IndicatorPowerDeviceProviderUPower * self,
+                                                              const char                         * object_path);
+
 G_END_DECLS
 
 #endif /* __INDICATOR_POWER_DEVICE_PROVIDER_UPOWER__H__ */
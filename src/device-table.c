@@ -0,0 +1,382 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "device-table.h"
+
+#include <math.h> /* isnan() */
+
+/* Baseline x86-64 can't vectorize the double comparisons in the kernels
+   below, so where the toolchain supports it, also build an AVX2 clone of
+   each one and let the loader pick the best that the CPU can run. */
+#if defined(__x86_64__) && defined(__has_attribute)
+ #if __has_attribute(target_clones)
+  #define KERNEL __attribute__((target_clones("avx2","default")))
+ #endif
+#endif
+#ifndef KERNEL
+ #define KERNEL
+#endif
+
+/* Priority keys, lowest first. The top bit sorts the devices that power
+   the system first, the next three bits are the class below, and the rest
+   orders devices within their class. See device_compare_func() in service.c */
+enum
+{
+  PRIORITY_DISCHARGING_WITH_TIME, /* least time left first */
+  PRIORITY_CHARGING, /* known times first, then most time to charge */
+  PRIORITY_DISCHARGING_LOW, /* no estimate, <= 10%: lowest first */
+  PRIORITY_OTHER, /* batteries, then other devices, then line power */
+  PRIORITY_UNKNOWN_STATE,
+  PRIORITY_DISCHARGING_NO_TIME /* no estimate, > 10%: always last */
+};
+
+#define PRIORITY_POWER_SUPPLY_SHIFT 63
+#define PRIORITY_CLASS_SHIFT 60
+#define PRIORITY_UNKNOWN_TIME_SHIFT 59
+#define PRIORITY_TIME_SHIFT 27 /* room for 100 / PERCENT_QUANTUM */
+
+/***
+****  Per-device helpers.
+****
+****  The bucket and level helpers count thresholds instead of walking
+****  an if-chain, so that the batch kernels that inline them vectorize.
+***/
+
+static inline guint8
+icon_index_of (gdouble p)
+{
+  /* don't round down to 20: see bug #1388235 */
+  return (p >=  5) + (p >= 15) + (p >= 21) + (p >= 35) + (p >= 45)
+       + (p >= 55) + (p >= 65) + (p >= 75) + (p >= 85) + (p >= 95);
+}
+
+static inline guint8
+fallback_icon_index_of (gdouble p)
+{
+  /* don't round down to 20: see bug #1559731 */
+  return (p >= 10) + (p > 20) + (p >= 50) + (p >= 70) + (p >= 90);
+}
+
+static inline guint8
+power_level_of (gdouble p)
+{
+  /* counted down so that NaN is "ok", like an if-chain would be */
+  return INDICATOR_POWER_LEVEL_OK - ((p <= 2) + (p <= 5) + (p <= 10));
+}
+
+static inline guint64
+get_percent_key (gdouble percentage)
+{
+  if (!(percentage > 0)) /* also catches NaN */
+    return 0;
+
+  return (guint64)(MIN (percentage, 100.0) / INDICATOR_POWER_DEVICE_TABLE_PERCENT_QUANTUM + 0.5);
+}
+
+static inline guint64
+get_kind_rank (guint8 kind)
+{
+  if (kind == UP_DEVICE_KIND_BATTERY)
+    return 0;
+
+  if (kind == UP_DEVICE_KIND_LINE_POWER)
+    return 2;
+
+  return 1;
+}
+
+static inline guint64
+get_priority (gdouble percentage,
+              gint64  time,
+              guint8  kind,
+              guint8  state,
+              guint8  power_supply)
+{
+  const guint64 t = (guint64) CLAMP (time, 0, G_MAXUINT32);
+  const guint64 percent_key = get_percent_key (percentage);
+  guint64 klass;
+  guint64 key;
+
+  if ((state == UP_DEVICE_STATE_DISCHARGING) && (time != 0))
+    {
+      klass = PRIORITY_DISCHARGING_WITH_TIME;
+      key = (t << PRIORITY_TIME_SHIFT) | percent_key;
+    }
+  else if (state == UP_DEVICE_STATE_CHARGING)
+    {
+      klass = PRIORITY_CHARGING;
+      if (time == 0) /* the comparator calls two unknown times a tie */
+        key = (guint64)1 << PRIORITY_UNKNOWN_TIME_SHIFT;
+      else
+        key = ((G_MAXUINT32 - t) << PRIORITY_TIME_SHIFT) | percent_key;
+    }
+  else if (state == UP_DEVICE_STATE_DISCHARGING)
+    {
+      klass = percentage > 10 ? PRIORITY_DISCHARGING_NO_TIME : PRIORITY_DISCHARGING_LOW;
+      key = percentage > 10 ? 0 : percent_key;
+    }
+  else if (state != UP_DEVICE_STATE_UNKNOWN)
+    {
+      klass = PRIORITY_OTHER;
+      key = (get_kind_rank (kind) << 8) | state;
+    }
+  else
+    {
+      klass = PRIORITY_UNKNOWN_STATE;
+      key = get_kind_rank (kind) << 8;
+    }
+
+  return ((guint64)!power_supply << PRIORITY_POWER_SUPPLY_SHIFT)
+       | (klass << PRIORITY_CLASS_SHIFT)
+       | key;
+}
+
+/* The priorities agree with the comparator whenever they differ, except
+   that NaN ties with everything there and a time that doesn't fit the key
+   is clamped here. Rows like that can't be ranked by priority alone. */
+static inline gboolean
+is_rankable (gdouble percentage,
+             gint64  time)
+{
+  return !isnan (percentage) && (time >= 0) && (time <= G_MAXUINT32);
+}
+
+/***
+****  Batch kernels.
+****
+****  Each of these is a loop over contiguous columns with no calls and
+****  no early exits.
+****
+****  The priorities aren't vectorized: their selects on doubles can't be
+****  if-converted without -fno-trapping-math. They still skip the
+****  GObject getters, which is where most of the per-device time went.
+***/
+
+KERNEL static void
+compute_icon_indices (const gdouble * restrict percentages,
+                      guint8        * restrict icon_indices,
+                      guint                    n)
+{
+  guint i;
+
+  for (i=0; i<n; ++i)
+    icon_indices[i] = icon_index_of (percentages[i]);
+}
+
+KERNEL static void
+compute_fallback_icon_indices (const gdouble * restrict percentages,
+                               guint8        * restrict fallback_icon_indices,
+                               guint                    n)
+{
+  guint i;
+
+  for (i=0; i<n; ++i)
+    fallback_icon_indices[i] = fallback_icon_index_of (percentages[i]);
+}
+
+KERNEL static void
+compute_power_levels (const gdouble * restrict percentages,
+                      const guint8  * restrict kinds,
+                      guint8        * restrict power_levels,
+                      guint                    n)
+{
+  guint i;
+
+  for (i=0; i<n; ++i)
+    {
+      const guint8 level = power_level_of (percentages[i]);
+      const guint8 is_battery = kinds[i] == UP_DEVICE_KIND_BATTERY;
+
+      power_levels[i] = is_battery ? level : INDICATOR_POWER_LEVEL_OK;
+    }
+}
+
+static void
+compute_priorities (const IndicatorPowerDeviceTable * table)
+{
+  const gdouble * restrict percentages = table->percentages;
+  const gint64 * restrict times = table->times;
+  const guint8 * restrict kinds = table->kinds;
+  const guint8 * restrict states = table->states;
+  const guint8 * restrict power_supplies = table->power_supplies;
+  guint64 * restrict priorities = table->priorities;
+  const guint n = table->n_devices;
+  guint i;
+
+  for (i=0; i<n; ++i)
+    priorities[i] = get_priority (percentages[i], times[i], kinds[i], states[i], power_supplies[i]);
+}
+
+/***
+****  Public API
+***/
+
+IndicatorPowerDeviceTable *
+indicator_power_device_table_new (guint n_devices)
+{
+  IndicatorPowerDeviceTable * table = g_new0 (IndicatorPowerDeviceTable, 1);
+
+  table->n_devices = n_devices;
+  table->percentages = g_new0 (gdouble, n_devices);
+  table->times = g_new0 (gint64, n_devices);
+  table->kinds = g_new0 (guint8, n_devices);
+  table->states = g_new0 (guint8, n_devices);
+  table->power_supplies = g_new0 (guint8, n_devices);
+  table->icon_indices = g_new0 (guint8, n_devices);
+  table->fallback_icon_indices = g_new0 (guint8, n_devices);
+  table->power_levels = g_new0 (guint8, n_devices);
+  table->priorities = g_new0 (guint64, n_devices);
+
+  return table;
+}
+
+IndicatorPowerDeviceTable *
+indicator_power_device_table_new_from_list (const GList * devices)
+{
+  IndicatorPowerDeviceTable * table = indicator_power_device_table_new (g_list_length ((GList*)devices));
+  const GList * l;
+  guint i;
+
+  for (l=devices, i=0; l!=NULL; l=l->next, ++i)
+    indicator_power_device_table_set_device (table, i, l->data);
+
+  return table;
+}
+
+void
+indicator_power_device_table_free (IndicatorPowerDeviceTable * table)
+{
+  if (table == NULL)
+    return;
+
+  g_free (table->percentages);
+  g_free (table->times);
+  g_free (table->kinds);
+  g_free (table->states);
+  g_free (table->power_supplies);
+  g_free (table->icon_indices);
+  g_free (table->fallback_icon_indices);
+  g_free (table->power_levels);
+  g_free (table->priorities);
+  g_free (table);
+}
+
+void
+indicator_power_device_table_set_device (IndicatorPowerDeviceTable  * table,
+                                         guint                        i,
+                                         const IndicatorPowerDevice * device)
+{
+  g_return_if_fail (table != NULL);
+  g_return_if_fail (i < table->n_devices);
+  g_return_if_fail (INDICATOR_IS_POWER_DEVICE (device));
+
+  table->percentages[i] = indicator_power_device_get_percentage (device);
+  table->times[i] = (gint64) indicator_power_device_get_time (device);
+  table->kinds[i] = (guint8) indicator_power_device_get_kind (device);
+  table->states[i] = (guint8) indicator_power_device_get_state (device);
+  table->power_supplies[i] = indicator_power_device_get_power_supply (device) ? 1 : 0;
+}
+
+void
+indicator_power_device_table_compute (IndicatorPowerDeviceTable * table)
+{
+  g_return_if_fail (table != NULL);
+
+  compute_icon_indices (table->percentages, table->icon_indices, table->n_devices);
+  compute_fallback_icon_indices (table->percentages, table->fallback_icon_indices, table->n_devices);
+  compute_power_levels (table->percentages, table->kinds, table->power_levels, table->n_devices);
+  compute_priorities (table);
+}
+
+/* If the lowest priority is unique and every row is rankable, that row
+   compares strictly before every other row both ways round. A merge sort
+   always takes such a row first, whatever it does with the ties below. */
+gboolean
+indicator_power_device_table_find_first (const IndicatorPowerDeviceTable * table,
+                                         guint                           * index)
+{
+  guint64 lowest = G_MAXUINT64;
+  guint n_lowest = 0;
+  guint first = 0;
+  guint i;
+
+  g_return_val_if_fail (table != NULL, FALSE);
+  g_return_val_if_fail (index != NULL, FALSE);
+
+  for (i=0; i<table->n_devices; ++i)
+    {
+      const guint64 priority = table->priorities[i];
+
+      if (!is_rankable (table->percentages[i], table->times[i]))
+        return FALSE;
+
+      if (priority < lowest)
+        {
+          lowest = priority;
+          first = i;
+          n_lowest = 1;
+        }
+      else if (priority == lowest)
+        {
+          ++n_lowest;
+        }
+    }
+
+  if (n_lowest != 1)
+    return FALSE;
+
+  *index = first;
+  return TRUE;
+}
+
+guint8
+indicator_power_device_table_get_icon_index (gdouble percentage)
+{
+  return icon_index_of (percentage);
+}
+
+guint8
+indicator_power_device_table_get_fallback_icon_index (gdouble percentage)
+{
+  return fallback_icon_index_of (percentage);
+}
+
+IndicatorPowerLevel
+indicator_power_device_table_get_power_level (gdouble percentage)
+{
+  return (IndicatorPowerLevel) power_level_of (percentage);
+}
+
+const char *
+indicator_power_device_table_icon_index_to_string (guint8 icon_index)
+{
+  static const char * const strings[] = { "000", "010", "020", "030", "040", "050",
+                                          "060", "070", "080", "090", "100" };
+
+  g_return_val_if_fail (icon_index < G_N_ELEMENTS (strings), NULL);
+
+  return strings[icon_index];
+}
+
+const char *
+indicator_power_device_table_fallback_icon_index_to_string (guint8 fallback_icon_index)
+{
+  static const char * const strings[] = { "000", "020", "040", "060", "080", "100" };
+
+  g_return_val_if_fail (fallback_icon_index < G_N_ELEMENTS (strings), NULL);
+
+  return strings[fallback_icon_index];
+}
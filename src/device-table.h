@@ -0,0 +1,145 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __INDICATOR_POWER_DEVICE_TABLE_H__
+#define __INDICATOR_POWER_DEVICE_TABLE_H__
+
+#include <glib.h>
+
+#include "device.h"
+
+G_BEGIN_DECLS
+
+/**
+ * A table of devices laid out as one array per property, so that
+ * render keys for hundreds or thousands of devices can be computed
+ * in one pass instead of one device at a time through the GObject
+ * getters.
+ *
+ * The keys are:
+ *
+ * - icon_indices: the bucket used in device icon names,
+ *   i.e. "000", "010", ... "100" is icon_index * 10
+ * - fallback_icon_indices: the bucket of the fallback icon names,
+ *   i.e. "000", "020", ... "100" is fallback_icon_index * 20
+ * - power_levels: the notifier's power level for batteries,
+ *   INDICATOR_POWER_LEVEL_OK for everything else
+ * - priorities: a sort key, lowest first, that orders devices the same
+ *   way the service does when picking the primary device. Percentages
+ *   are compared to INDICATOR_POWER_DEVICE_TABLE_PERCENT_QUANTUM.
+ *
+ * The per-device functions at the end compute the same buckets and levels
+ * for one percentage. They're what device.c and the notifier use, so there
+ * is only one copy of each set of thresholds.
+ */
+
+typedef enum
+{
+  INDICATOR_POWER_LEVEL_CRITICAL,
+  INDICATOR_POWER_LEVEL_VERY_LOW,
+  INDICATOR_POWER_LEVEL_LOW,
+  INDICATOR_POWER_LEVEL_OK
+}
+IndicatorPowerLevel;
+
+#define INDICATOR_POWER_DEVICE_TABLE_PERCENT_QUANTUM 1e-6
+
+typedef struct
+{
+  guint n_devices;
+
+  /* inputs */
+  gdouble * percentages;
+  gint64  * times; /* seconds */
+  guint8  * kinds; /* UpDeviceKind */
+  guint8  * states; /* UpDeviceState */
+  guint8  * power_supplies; /* 0 or 1 */
+
+  /* outputs */
+  guint8  * icon_indices;
+  guint8  * fallback_icon_indices;
+  guint8  * power_levels; /* IndicatorPowerLevel */
+  guint64 * priorities;
+}
+IndicatorPowerDeviceTable;
+
+IndicatorPowerDeviceTable * indicator_power_device_table_new (guint n_devices);
+
+/**
+ * Creates a table with a row for each device in @devices, in order
+ */
+IndicatorPowerDeviceTable * indicator_power_device_table_new_from_list (const GList * devices);
+
+void indicator_power_device_table_free (IndicatorPowerDeviceTable * table);
+
+/**
+ * Copies @device's properties into row @i of @table's inputs
+ */
+void indicator_power_device_table_set_device (IndicatorPowerDeviceTable  * table,
+                                              guint                        i,
+                                              const IndicatorPowerDevice * device);
+
+/**
+ * Computes every output column from the input columns.
+ *
+ * The kernels are simple loops over the contiguous columns, written so
+ * that the compiler can vectorize them.
+ */
+void indicator_power_device_table_compute (IndicatorPowerDeviceTable * table);
+
+/**
+ * Finds the row that sorting the devices with the service's comparator
+ * would put first. Needs indicator_power_device_table_compute().
+ *
+ * The comparator calls some pairs a tie by saying that each goes after
+ * the other, and then the sort's merge order decides. The priorities
+ * can't see that, so this gives up if the lowest priority is shared,
+ * or if a NaN percentage or a negative time makes the comparator
+ * inconsistent.
+ *
+ * Returns: TRUE and sets @index if the first row is certain
+ */
+gboolean indicator_power_device_table_find_first (const IndicatorPowerDeviceTable * table,
+                                                  guint                           * index);
+
+/**
+ * Returns the icon bucket of @percentage, as in icon_indices
+ */
+guint8 indicator_power_device_table_get_icon_index (gdouble percentage);
+
+/**
+ * Returns the fallback icon bucket of @percentage, as in fallback_icon_indices
+ */
+guint8 indicator_power_device_table_get_fallback_icon_index (gdouble percentage);
+
+/**
+ * Returns the power level of a battery at @percentage, as in power_levels
+ */
+IndicatorPowerLevel indicator_power_device_table_get_power_level (gdouble percentage);
+
+/**
+ * Returns an icon index as used in icon names, e.g. "030"
+ */
+const char * indicator_power_device_table_icon_index_to_string (guint8 icon_index);
+
+/**
+ * Returns a fallback icon index as used in icon names, e.g. "040"
+ */
+const char * indicator_power_device_table_fallback_icon_index_to_string (guint8 fallback_icon_index);
+
+G_END_DECLS
+
+#endif /* __INDICATOR_POWER_DEVICE_TABLE_H__ */
@@ -31,6 +31,7 @@ License along with this library. If not, see
 #include <gio/gio.h>
 
 #include "device.h"
+#include "device-table.h"
 
 struct _IndicatorPowerDevicePrivate
 {
@@ -40,11 +41,16 @@ struct _IndicatorPowerDevicePrivate
   gdouble percentage;
   time_t time;
 
-  /* Timestamp of when when we first noticed that upower couldn't estimate
-     the time-remaining field for this device, or 0 if not applicable.
-     This is used when generating the time-remaining string. */
-  GTimer * inestimable;
+  /* Monotonic timestamp of when we first noticed that upower couldn't
+     estimate the time-remaining field for this device, or 0 if not
+     applicable. This is used when generating the time-remaining string.
+     It's a plain value rather than a GTimer so that snapshots made with
+     indicator_power_device_copy() can carry it to another thread. */
+  gint64 inestimable;
   gboolean power_supply;
+
+  /* The charge/discharge rate in watts, or 0 if unknown or not wanted */
+  gdouble energy_rate;
 };
 
 /* Properties */
@@ -57,6 +63,7 @@ enum {
   PROP_PERCENTAGE,
   PROP_TIME,
   PROP_POWER_SUPPLY,
+  PROP_ENERGY_RATE,
   N_PROPERTIES
 };
 
@@ -65,7 +72,6 @@ static GParamSpec * properties[N_PROPERTIES];
 /* GObject stuff */
 static void indicator_power_device_class_init (IndicatorPowerDeviceClass *klass);
 static void indicator_power_device_init       (IndicatorPowerDevice *self);
-static void indicator_power_device_dispose    (GObject *object);
 static void indicator_power_device_finalize   (GObject *object);
 static void set_property (GObject*, guint prop_id, const GValue*, GParamSpec* );
 static void get_property (GObject*, guint prop_id,       GValue*, GParamSpec* );
@@ -79,7 +85,6 @@ indicator_power_device_class_init (IndicatorPowerDeviceClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
-  object_class->dispose = indicator_power_device_dispose;
   object_class->finalize = indicator_power_device_finalize;
   object_class->set_property = set_property;
   object_class->get_property = get_property;
@@ -124,6 +129,13 @@ indicator_power_device_class_init (IndicatorPowerDeviceClass *klass)
                                                         FALSE,
                                                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_ENERGY_RATE] = g_param_spec_double (INDICATOR_POWER_DEVICE_ENERGY_RATE,
+                                                      "energy rate",
+                                                      "charge/discharge rate in watts",
+                                                      0.0, G_MAXDOUBLE,
+                                                      0.0,
+                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (object_class, N_PROPERTIES, properties);
 }
 
@@ -140,21 +152,12 @@ indicator_power_device_init (IndicatorPowerDevice *self)
   priv->percentage = 0.0;
   priv->time = 0;
   priv->power_supply = FALSE;
+  priv->energy_rate = 0.0;
+  priv->inestimable = 0;
 
   self->priv = priv;
 }
 
-static void
-indicator_power_device_dispose (GObject *object)
-{
-  IndicatorPowerDevice * self = INDICATOR_POWER_DEVICE(object);
-  IndicatorPowerDevicePrivate * p = self->priv;
-
-  g_clear_pointer (&p->inestimable, g_timer_destroy);
-
-  G_OBJECT_CLASS (indicator_power_device_parent_class)->dispose (object);
-}
-
 static void
 indicator_power_device_finalize (GObject *object)
 {
@@ -202,6 +205,10 @@ get_property (GObject * o, guint  prop_id, GValue * value, GParamSpec * pspec)
         g_value_set_boolean (value, priv->power_supply);
         break;
 
+      case PROP_ENERGY_RATE:
+        g_value_set_double (value, priv->energy_rate);
+        break;
+
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(o, prop_id, pspec);
         break;
@@ -241,6 +248,10 @@ set_property (GObject * o, guint prop_id, const GValue * value, GParamSpec * psp
         p->power_supply = g_value_get_boolean (value);
         break;
 
+      case PROP_ENERGY_RATE:
+        p->energy_rate = g_value_get_double (value);
+        break;
+
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(o, prop_id, pspec);
         break;
@@ -258,11 +269,11 @@ set_property (GObject * o, guint prop_id, const GValue * value, GParamSpec * psp
 
   if (!is_inestimable)
     {
-      g_clear_pointer (&p->inestimable, g_timer_destroy);
+      p->inestimable = 0;
     }
-  else if (p->inestimable == NULL)
+  else if (p->inestimable == 0)
     {
-      p->inestimable = g_timer_new ();
+      p->inestimable = g_get_monotonic_time ();
     }
 }
 
@@ -330,6 +341,16 @@ indicator_power_device_get_power_supply (const IndicatorPowerDevice * device)
   return device->priv->power_supply;
 }
 
+gdouble
+indicator_power_device_get_energy_rate (const IndicatorPowerDevice * device)
+{
+  /* LCOV_EXCL_START */
+  g_return_val_if_fail (INDICATOR_IS_POWER_DEVICE(device), 0.0);
+  /* LCOV_EXCL_STOP */
+
+  return device->priv->energy_rate;
+}
+
 /***
 ****
 ****
@@ -344,35 +365,8 @@ get_device_icon_suffix (gdouble percentage)
   return "caution";
 }
 
-static const gchar *
-get_closest_10_percent_percentage (gdouble percentage)
-{
-  if (percentage >= 95) return "100";
-  if (percentage >= 85) return "090";
-  if (percentage >= 75) return "080";
-  if (percentage >= 65) return "070";
-  if (percentage >= 55) return "060";
-  if (percentage >= 45) return "050";
-  if (percentage >= 35) return "040";
-  if (percentage >= 21) return "030"; /* don't round down to 20: see bug #1388235 */
-  if (percentage >= 15) return "020";
-  if (percentage >=  5) return "010";
-  return "000";
-}
-
-static const gchar *
-get_fallback_device_icon_index (gdouble percentage)
-{
-  if (percentage >= 90) return "100";
-  if (percentage >= 70) return "080";
-  if (percentage >= 50) return "060";
-  if (percentage >  20) return "040"; /* don't round down to 20: see bug #1559731 */
-  if (percentage >= 10) return "020";
-  return "000";
-}
-
-static const char *
-device_kind_to_string (UpDeviceKind kind)
+const char *
+indicator_power_device_kind_to_string (UpDeviceKind kind)
 {
   switch (kind)
     {
@@ -391,31 +385,21 @@ device_kind_to_string (UpDeviceKind kind)
     }
 }
 
-/**
-  indicator_power_device_get_icon_names:
-  @device: #IndicatorPowerDevice from which to generate the icon names
-
-  See also indicator_power_device_get_gicon().
-
-  Return value: (array zero-terminated=1) (transfer full):
-  A GStrv of icon names suitable for passing to g_themed_icon_new_from_names().
-  Free with g_strfreev() when done.
-*/
-GStrv
-indicator_power_device_get_icon_names (const IndicatorPowerDevice * device)
+/* The percentage buckets are passed in so that callers with a whole
+   IndicatorPowerDeviceTable can use the ones it computed in bulk */
+static GStrv
+get_icon_names (const IndicatorPowerDevice * device,
+                guint8                       icon_index,
+                guint8                       fallback_icon_index)
 {
   const gchar *suffix_str;
   const gchar *index_str;
   const gchar *index_str_2;
 
-  /* LCOV_EXCL_START */
-  g_return_val_if_fail (INDICATOR_IS_POWER_DEVICE(device), NULL);
-  /* LCOV_EXCL_STOP */
-
   gdouble percentage = indicator_power_device_get_percentage (device);
   const UpDeviceKind kind = indicator_power_device_get_kind (device);
   const UpDeviceState state = indicator_power_device_get_state (device);
-  const gchar * kind_str = device_kind_to_string (kind);
+  const gchar * kind_str = indicator_power_device_kind_to_string (kind);
 
   GPtrArray * names = g_ptr_array_new ();
 
@@ -450,10 +434,10 @@ indicator_power_device_get_icon_names (const IndicatorPowerDevice * device)
       case UP_DEVICE_STATE_CHARGING:
 
         suffix_str = get_device_icon_suffix (percentage);
-        index_str = get_closest_10_percent_percentage (percentage);
+        index_str = indicator_power_device_table_icon_index_to_string (icon_index);
         g_ptr_array_add (names, g_strdup_printf ("%s-%s-charging", kind_str, index_str));
         g_ptr_array_add (names, g_strdup_printf ("gpm-%s-%s-charging", kind_str, index_str));
-        index_str_2 = get_fallback_device_icon_index (percentage);
+        index_str_2 = indicator_power_device_table_fallback_icon_index_to_string (fallback_icon_index);
         if (g_strcmp0 (index_str, index_str_2))
           {
             g_ptr_array_add (names, g_strdup_printf ("%s-%s-charging", kind_str, index_str_2));
@@ -468,10 +452,10 @@ indicator_power_device_get_icon_names (const IndicatorPowerDevice * device)
       case UP_DEVICE_STATE_PENDING_DISCHARGE:
       case UP_DEVICE_STATE_UNKNOWN: /* http://pad.lv/1470080 */
         suffix_str = get_device_icon_suffix (percentage);
-        index_str = get_closest_10_percent_percentage (percentage);
+        index_str = indicator_power_device_table_icon_index_to_string (icon_index);
         g_ptr_array_add (names, g_strdup_printf ("%s-%s", kind_str, index_str));
         g_ptr_array_add (names, g_strdup_printf ("gpm-%s-%s", kind_str, index_str));
-        index_str_2 = get_fallback_device_icon_index (percentage);
+        index_str_2 = indicator_power_device_table_fallback_icon_index_to_string (fallback_icon_index);
         if (g_strcmp0 (index_str, index_str_2))
           {
             g_ptr_array_add (names, g_strdup_printf ("%s-%s", kind_str, index_str_2));
@@ -491,6 +475,32 @@ indicator_power_device_get_icon_names (const IndicatorPowerDevice * device)
     return (GStrv) g_ptr_array_free (names, FALSE);
 }
 
+/**
+  indicator_power_device_get_icon_names:
+  @device: #IndicatorPowerDevice from which to generate the icon names
+
+  See also indicator_power_device_get_gicon().
+
+  Return value: (array zero-terminated=1) (transfer full):
+  A GStrv of icon names suitable for passing to g_themed_icon_new_from_names().
+  Free with g_strfreev() when done.
+*/
+GStrv
+indicator_power_device_get_icon_names (const IndicatorPowerDevice * device)
+{
+  gdouble percentage;
+
+  /* LCOV_EXCL_START */
+  g_return_val_if_fail (INDICATOR_IS_POWER_DEVICE(device), NULL);
+  /* LCOV_EXCL_STOP */
+
+  percentage = indicator_power_device_get_percentage (device);
+
+  return get_icon_names (device,
+                         indicator_power_device_table_get_icon_index (percentage),
+                         indicator_power_device_table_get_fallback_icon_index (percentage));
+}
+
 /**
   indicator_power_device_get_gicon:
   @device: #IndicatorPowerDevice to generate the icon names from
@@ -509,6 +519,35 @@ indicator_power_device_get_gicon (const IndicatorPowerDevice * device)
   return icon;
 }
 
+/**
+  indicator_power_device_get_gicon_for_buckets:
+  @device: #IndicatorPowerDevice to generate the icon names from
+  @icon_index: @device's icon bucket, see indicator_power_device_table_get_icon_index()
+  @fallback_icon_index: @device's fallback icon bucket
+
+  Like indicator_power_device_get_gicon(), but with buckets that were
+  already computed, e.g. for a whole IndicatorPowerDeviceTable at once.
+
+  Return value: (transfer full): A themed GIcon
+*/
+GIcon *
+indicator_power_device_get_gicon_for_buckets (const IndicatorPowerDevice * device,
+                                              guint8                       icon_index,
+                                              guint8                       fallback_icon_index)
+{
+  GStrv names;
+  GIcon * icon;
+
+  /* LCOV_EXCL_START */
+  g_return_val_if_fail (INDICATOR_IS_POWER_DEVICE(device), NULL);
+  /* LCOV_EXCL_STOP */
+
+  names = get_icon_names (device, icon_index, fallback_icon_index);
+  icon = g_themed_icon_new_from_names (names, -1);
+  g_strfreev (names);
+  return icon;
+}
+
 /***
 ****
 ***/
@@ -569,7 +608,7 @@ device_kind_to_localised_string (UpDeviceKind kind)
       break;
     default:
       g_warning ("enum unrecognised: %i", kind);
-      text = device_kind_to_string (kind);
+      text = indicator_power_device_kind_to_string (kind);
     }
 
   return text;
@@ -599,9 +638,9 @@ get_brief_time_remaining (const IndicatorPowerDevice * device)
 
       str = g_strdup_printf("%0d:%02d", hours, minutes);
     }
-  else if (p->inestimable != NULL)
+  else if (p->inestimable != 0)
     {
-      const double elapsed = g_timer_elapsed (p->inestimable, NULL);
+      const double elapsed = (g_get_monotonic_time () - p->inestimable) / (double)G_USEC_PER_SEC;
 
       if (elapsed < 30)
         {
@@ -736,6 +775,30 @@ time_is_relevant (const IndicatorPowerDevice * device)
   return FALSE;
 }
 
+/**
+ * The '''power string''' for a component is its charge/discharge rate
+ * in watts with one decimal place, e.g. “12.3 W”, or NULL if the rate
+ * is unknown. The accessible form spells out the unit.
+ */
+static char *
+get_power_string (const IndicatorPowerDevice * device,
+                  gboolean                     accessible)
+{
+  const IndicatorPowerDevicePrivate * p = device->priv;
+
+  if (p->energy_rate < 0.05)
+    return NULL;
+
+  if (accessible)
+    {
+      /* TRANSLATORS: the battery's charge/discharge rate. Example: "12.3 watts" */
+      return g_strdup_printf (_("%.1f watts"), p->energy_rate);
+    }
+
+  /* TRANSLATORS: the battery's charge/discharge rate. Example: "12.3 W" */
+  return g_strdup_printf (_("%.1f W"), p->energy_rate);
+}
+
 /**
  * The menu item for each chargeable component should consist of ...
  * Text representing the name of the component (“Battery”, “Mouse”,
@@ -746,13 +809,17 @@ time_is_relevant (const IndicatorPowerDevice * device)
  *    or discharging with less than 24 hours left;
  *  * “X” if it is discharging with 24 hours or more left.
  *
+ * If the charge/discharge rate is known and @want_power is set, the
+ * power string follows the time inside the brackets: “X (1:42 left, 12.3 W)”.
+ *
  * The accessible label for the menu item should be the same as the
  * visible label, except with the accessible time-remaining string
  * instead of the expanded time-remaining string.
  */
 static char *
 get_menuitem_text (const IndicatorPowerDevice * device,
-                   gboolean                     accessible)
+                   gboolean                     accessible,
+                   gboolean                     want_power)
 {
   char * str = NULL;
   const IndicatorPowerDevicePrivate * p = device->priv;
@@ -766,6 +833,7 @@ get_menuitem_text (const IndicatorPowerDevice * device,
   else
     {
       char * time_str = NULL;
+      char * power_str = want_power ? get_power_string (device, accessible) : NULL;
 
       if (time_is_relevant (device))
         {
@@ -775,16 +843,27 @@ get_menuitem_text (const IndicatorPowerDevice * device,
             time_str = get_expanded_time_remaining (device);
         }
 
-      if (time_str && *time_str)
+      if (time_str && *time_str && power_str)
+        {
+          /* TRANSLATORS: example: "battery (time remaining, power)" */
+          str = g_strdup_printf (_("%s (%s, %s)"), kind_str, time_str, power_str);
+        }
+      else if (time_str && *time_str)
         {
           /* TRANSLATORS: example: "battery (time remaining)" */
           str = g_strdup_printf (_("%s (%s)"), kind_str, time_str);
         }
+      else if (power_str)
+        {
+          /* TRANSLATORS: example: "battery (power)" */
+          str = g_strdup_printf (_("%s (%s)"), kind_str, power_str);
+        }
       else
         {
           str = g_strdup (kind_str);
         }
 
+      g_free (power_str);
       g_free (time_str);
     }
 
@@ -796,7 +875,7 @@ indicator_power_device_get_readable_text (const IndicatorPowerDevice * device)
 {
   g_return_val_if_fail (INDICATOR_IS_POWER_DEVICE(device), NULL);
 
-  return get_menuitem_text (device, FALSE);
+  return get_menuitem_text (device, FALSE, TRUE);
 }
 
 char *
@@ -804,7 +883,7 @@ indicator_power_device_get_accessible_text (const IndicatorPowerDevice * device)
 {
   g_return_val_if_fail (INDICATOR_IS_POWER_DEVICE(device), NULL);
 
-  return get_menuitem_text (device, TRUE);
+  return get_menuitem_text (device, TRUE, TRUE);
 }
 
 /**
@@ -818,14 +897,19 @@ indicator_power_device_get_accessible_text (const IndicatorPowerDevice * device)
  * the brackets should contain the percentage charge for that device.
  *
  * If both conditions are true, the time and percentage should be separated by a space.
+ *
+ * If “Show power in Menu Bar” is checked and the charge/discharge rate
+ * is known, the power string goes last inside the brackets.
  */
 char*
 indicator_power_device_get_readable_title (const IndicatorPowerDevice * device,
                                            gboolean                     want_time,
-                                           gboolean                     want_percent)
+                                           gboolean                     want_percent,
+                                           gboolean                     want_power)
 {
   char * str = NULL;
   char * time_str = NULL;
+  char * power_str = NULL;
   const IndicatorPowerDevicePrivate * p;
 
   g_return_val_if_fail (INDICATOR_IS_POWER_DEVICE(device), NULL);
@@ -847,7 +931,34 @@ indicator_power_device_get_readable_title (const IndicatorPowerDevice * device,
       want_time = time_str && *time_str;
     }
 
-  if (want_time && want_percent)
+  // try to build the power string
+  if (want_power)
+    {
+      power_str = get_power_string (device, FALSE);
+      want_power = power_str != NULL;
+    }
+
+  if (want_time && want_percent && want_power)
+    {
+      /* TRANSLATORS: after the icon, a time-remaining string + battery % + power. Example: "(0:59, 33%, 12.3 W)" */
+      str = g_strdup_printf (_("(%s, %.0lf%%, %s)"), time_str, p->percentage, power_str);
+    }
+  else if (want_time && want_power)
+    {
+      /* TRANSLATORS: after the icon, a time-remaining string + power. Example: "(0:59, 12.3 W)" */
+      str = g_strdup_printf (_("(%s, %s)"), time_str, power_str);
+    }
+  else if (want_percent && want_power)
+    {
+      /* TRANSLATORS: after the icon, a battery % + power. Example: "(33%, 12.3 W)" */
+      str = g_strdup_printf (_("(%.0lf%%, %s)"), p->percentage, power_str);
+    }
+  else if (want_power)
+    {
+      /* TRANSLATORS: after the icon, a power string. Example: "(12.3 W)" */
+      str = g_strdup_printf (_("(%s)"), power_str);
+    }
+  else if (want_time && want_percent)
     {
       /* TRANSLATORS: after the icon, a time-remaining string + battery %. Example: "(0:59, 33%)" */
       str = g_strdup_printf (_("(%s, %.0lf%%)"), time_str, p->percentage);
@@ -867,22 +978,26 @@ indicator_power_device_get_readable_title (const IndicatorPowerDevice * device,
       str = NULL;
     }
 
+  g_free (power_str);
   g_free (time_str);
   return str;
 }
 
 /**
  * Regardless, the accessible name for the whole menu title should be the same
- * as the accessible name for that thing’s component inside the menu itself.
+ * as the accessible name for that thing’s component inside the menu itself,
+ * except that like the readable title it only mentions the charge/discharge
+ * rate if “Show power in Menu Bar” is checked.
  */
 char *
 indicator_power_device_get_accessible_title (const IndicatorPowerDevice * device,
                                              gboolean                     want_time G_GNUC_UNUSED,
-                                             gboolean                     want_percent G_GNUC_UNUSED)
+                                             gboolean                     want_percent G_GNUC_UNUSED,
+                                             gboolean                     want_power)
 {
   g_return_val_if_fail (INDICATOR_IS_POWER_DEVICE(device), NULL);
 
-  return indicator_power_device_get_accessible_text (device);
+  return get_menuitem_text (device, TRUE, want_power);
 }
 
 /***
@@ -908,6 +1023,35 @@ indicator_power_device_new (const gchar * object_path,
   return INDICATOR_POWER_DEVICE(o);
 }
 
+/**
+ * Creates a detached snapshot of @device.
+ *
+ * The copy has no signal connections and shares no mutable state with
+ * @device, so it can be handed to a worker thread while @device keeps
+ * changing on the main thread. The time-remaining text of the copy is
+ * generated as if it had been inestimable for as long as @device has.
+ */
+IndicatorPowerDevice *
+indicator_power_device_copy (const IndicatorPowerDevice * device)
+{
+  const IndicatorPowerDevicePrivate * p;
+  IndicatorPowerDevice * copy;
+
+  g_return_val_if_fail (INDICATOR_IS_POWER_DEVICE(device), NULL);
+
+  p = device->priv;
+  copy = indicator_power_device_new (p->object_path,
+                                     p->kind,
+                                     p->percentage,
+                                     p->state,
+                                     p->time,
+                                     p->power_supply);
+  copy->priv->inestimable = p->inestimable;
+  copy->priv->energy_rate = p->energy_rate;
+
+  return copy;
+}
+
 IndicatorPowerDevice *
 indicator_power_device_new_from_variant (GVariant * v)
 {
@@ -45,6 +45,7 @@ typedef struct _IndicatorPowerDevicePrivate IndicatorPowerDevicePrivate;
 #define INDICATOR_POWER_DEVICE_PERCENTAGE   "percentage"
 #define INDICATOR_POWER_DEVICE_TIME         "time"
 #define INDICATOR_POWER_DEVICE_POWER_SUPPLY "power-supply"
+#define INDICATOR_POWER_DEVICE_ENERGY_RATE  "energy-rate"
 
 typedef enum
 {
@@ -117,6 +118,11 @@ IndicatorPowerDevice* indicator_power_device_new (const gchar    * object_path,
  */
 IndicatorPowerDevice* indicator_power_device_new_from_variant (GVariant * variant);
 
+/**
+ * Returns a snapshot of @device that is safe to read from another thread
+ */
+IndicatorPowerDevice* indicator_power_device_copy (const IndicatorPowerDevice * device);
+
 
 UpDeviceKind  indicator_power_device_get_kind              (const IndicatorPowerDevice * device);
 UpDeviceState indicator_power_device_get_state             (const IndicatorPowerDevice * device);
@@ -124,9 +130,18 @@ const gchar * indicator_power_device_get_object_path       (const IndicatorPower
 gdouble       indicator_power_device_get_percentage        (const IndicatorPowerDevice * device);
 time_t        indicator_power_device_get_time              (const IndicatorPowerDevice * device);
 gboolean      indicator_power_device_get_power_supply      (const IndicatorPowerDevice * device);
+gdouble       indicator_power_device_get_energy_rate       (const IndicatorPowerDevice * device);
+
+/**
+ * Returns the unlocalised name of @kind, e.g. "battery" or "mouse"
+ */
+const char  * indicator_power_device_kind_to_string        (UpDeviceKind kind);
 
 GStrv         indicator_power_device_get_icon_names        (const IndicatorPowerDevice * device);
 GIcon       * indicator_power_device_get_gicon             (const IndicatorPowerDevice * device);
+GIcon       * indicator_power_device_get_gicon_for_buckets (const IndicatorPowerDevice * device,
+                                                            guint8                       icon_index,
+                                                            guint8                       fallback_icon_index);
 
 
 char        * indicator_power_device_get_readable_text     (const IndicatorPowerDevice * device);
@@ -135,11 +150,13 @@ char        * indicator_power_device_get_accessible_text   (const IndicatorPower
 
 char        * indicator_power_device_get_readable_title    (const IndicatorPowerDevice * device,
                                                             gboolean                     want_time,
-                                                            gboolean                     want_percent);
+                                                            gboolean                     want_percent,
+                                                            gboolean                     want_power);
 
 char        * indicator_power_device_get_accessible_title  (const IndicatorPowerDevice * device,
                                                             gboolean                     want_time,
-                                                            gboolean                     want_percent);
+                                                            gboolean                     want_percent,
+                                                            gboolean                     want_power);
 
 
 G_END_DECLS
@@ -23,6 +23,7 @@
 #include <glib/gi18n.h>
 
 #include "device.h"
+#include "device-provider-upower.h"
 #include "notifier.h"
 #include "service.h"
 #include "testing.h"
@@ -42,8 +43,9 @@ int
 main (int argc G_GNUC_UNUSED, char ** argv G_GNUC_UNUSED)
 {
   IndicatorPowerNotifier * notifier;
+  IndicatorPowerDeviceProvider * device_provider = NULL;
   IndicatorPowerService * service;
-  IndicatorPowerTesting * testing;
+  IndicatorPowerTesting * testing = NULL;
   GMainLoop * loop;
 
   /* boilerplate i18n */
@@ -54,7 +56,19 @@ main (int argc G_GNUC_UNUSED, char ** argv G_GNUC_UNUSED)
   /* run */
   notifier = indicator_power_notifier_new();
   service = indicator_power_service_new(NULL, notifier);
-  testing = indicator_power_testing_new (service);
+  g_object_set (service, "threaded-payloads", TRUE, NULL);
+
+  /* the Testing interface, with its mock battery, is opt-in */
+  if (g_getenv ("INDICATOR_POWER_TESTING") != NULL)
+    {
+      testing = indicator_power_testing_new (service);
+    }
+  else
+    {
+      device_provider = indicator_power_device_provider_upower_new ();
+      indicator_power_service_set_device_provider (service, device_provider);
+    }
+
   loop = g_main_loop_new (NULL, FALSE);
   g_signal_connect (service, INDICATOR_POWER_SERVICE_SIGNAL_NAME_LOST,
                     G_CALLBACK(on_name_lost), loop);
@@ -64,6 +78,7 @@ main (int argc G_GNUC_UNUSED, char ** argv G_GNUC_UNUSED)
   g_main_loop_unref (loop);
   g_clear_object (&testing);
   g_clear_object (&service);
+  g_clear_object (&device_provider);
   g_clear_object (&notifier);
   return 0;
 }
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "memory-pressure.h"
+
+#include <stdio.h> /* sscanf() */
+#include <unistd.h> /* sysconf() */
+
+#ifdef __GLIBC__
+ #include <malloc.h> /* malloc_trim() */
+#endif
+
+enum
+{
+  SIGNAL_SHED,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+enum
+{
+  PROP_0,
+  PROP_MEMORY_MONITOR,
+  PROP_BYTES_RELEASED,
+  LAST_PROP
+};
+
+static GParamSpec * properties[LAST_PROP];
+
+typedef struct
+{
+  GMemoryMonitor * monitor;
+  guint64 bytes_released;
+}
+IndicatorPowerMemoryPressurePrivate;
+
+typedef IndicatorPowerMemoryPressurePrivate priv_t;
+
+G_DEFINE_TYPE_WITH_PRIVATE(IndicatorPowerMemoryPressure,
+                           indicator_power_memory_pressure,
+                           G_TYPE_OBJECT)
+
+#define get_priv(o) ((priv_t*)indicator_power_memory_pressure_get_instance_private(o))
+
+/***
+****
+***/
+
+/* Returns: the process's resident set size in bytes, or -1 on error */
+static gint64
+get_resident_bytes (void)
+{
+  gchar * contents = NULL;
+  gint64 pages = -1;
+
+  if (g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+    {
+      if (sscanf (contents, "%*s %" G_GINT64_FORMAT, &pages) != 1)
+        pages = -1;
+
+      g_free (contents);
+    }
+
+  return pages < 0 ? -1 : pages * sysconf (_SC_PAGESIZE);
+}
+
+static void
+on_low_memory_warning (GMemoryMonitor             * monitor G_GNUC_UNUSED,
+                       GMemoryMonitorWarningLevel   level,
+                       gpointer                     gself)
+{
+  indicator_power_memory_pressure_shed (INDICATOR_POWER_MEMORY_PRESSURE (gself), level);
+}
+
+/***
+****  GObject virtual functions
+***/
+
+static void
+my_get_property (GObject     * o,
+                 guint         property_id,
+                 GValue      * value,
+                 GParamSpec  * pspec)
+{
+  priv_t * p = get_priv (INDICATOR_POWER_MEMORY_PRESSURE (o));
+
+  switch (property_id)
+    {
+      case PROP_MEMORY_MONITOR:
+        g_value_set_object (value, p->monitor);
+        break;
+
+      case PROP_BYTES_RELEASED:
+        g_value_set_uint64 (value, p->bytes_released);
+        break;
+
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (o, property_id, pspec);
+    }
+}
+
+static void
+my_set_property (GObject       * o,
+                 guint           property_id,
+                 const GValue  * value,
+                 GParamSpec    * pspec)
+{
+  priv_t * p = get_priv (INDICATOR_POWER_MEMORY_PRESSURE (o));
+
+  switch (property_id)
+    {
+      case PROP_MEMORY_MONITOR:
+        p->monitor = g_value_dup_object (value);
+        break;
+
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (o, property_id, pspec);
+    }
+}
+
+static void
+my_constructed (GObject * o)
+{
+  priv_t * p = get_priv (INDICATOR_POWER_MEMORY_PRESSURE (o));
+
+  if (p->monitor == NULL)
+    p->monitor = g_memory_monitor_dup_default ();
+
+  g_signal_connect (p->monitor, "low-memory-warning",
+                    G_CALLBACK(on_low_memory_warning), o);
+
+  G_OBJECT_CLASS (indicator_power_memory_pressure_parent_class)->constructed (o);
+}
+
+static void
+my_dispose (GObject * o)
+{
+  priv_t * p = get_priv (INDICATOR_POWER_MEMORY_PRESSURE (o));
+
+  if (p->monitor != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (p->monitor, o);
+      g_clear_object (&p->monitor);
+    }
+
+  G_OBJECT_CLASS (indicator_power_memory_pressure_parent_class)->dispose (o);
+}
+
+/***
+****  Instantiation
+***/
+
+static void
+indicator_power_memory_pressure_init (IndicatorPowerMemoryPressure * self G_GNUC_UNUSED)
+{
+}
+
+static void
+indicator_power_memory_pressure_class_init (IndicatorPowerMemoryPressureClass * klass)
+{
+  GObjectClass * object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = my_constructed;
+  object_class->dispose = my_dispose;
+  object_class->get_property = my_get_property;
+  object_class->set_property = my_set_property;
+
+  signals[SIGNAL_SHED] = g_signal_new (
+    INDICATOR_POWER_MEMORY_PRESSURE_SIGNAL_SHED,
+    G_TYPE_FROM_CLASS(klass),
+    G_SIGNAL_RUN_LAST,
+    G_STRUCT_OFFSET (IndicatorPowerMemoryPressureClass, shed),
+    NULL, NULL,
+    g_cclosure_marshal_VOID__ENUM,
+    G_TYPE_NONE, 1, G_TYPE_MEMORY_MONITOR_WARNING_LEVEL);
+
+  properties[PROP_0] = NULL;
+
+  properties[PROP_MEMORY_MONITOR] = g_param_spec_object (
+    INDICATOR_POWER_MEMORY_PRESSURE_PROP_MEMORY_MONITOR,
+    "Memory Monitor",
+    "The source of low-memory warnings",
+    G_TYPE_MEMORY_MONITOR,
+    G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_BYTES_RELEASED] = g_param_spec_uint64 (
+    INDICATOR_POWER_MEMORY_PRESSURE_PROP_BYTES_RELEASED,
+    "Bytes Released",
+    "Total resident memory given back on low-memory warnings",
+    0, G_MAXUINT64, 0,
+    G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, LAST_PROP, properties);
+}
+
+/***
+****  Public API
+***/
+
+IndicatorPowerMemoryPressure *
+indicator_power_memory_pressure_new (GMemoryMonitor * monitor)
+{
+  GObject * o = g_object_new (INDICATOR_TYPE_POWER_MEMORY_PRESSURE,
+                              INDICATOR_POWER_MEMORY_PRESSURE_PROP_MEMORY_MONITOR, monitor,
+                              NULL);
+
+  return INDICATOR_POWER_MEMORY_PRESSURE (o);
+}
+
+guint64
+indicator_power_memory_pressure_shed (IndicatorPowerMemoryPressure * self,
+                                      GMemoryMonitorWarningLevel     level)
+{
+  priv_t * p;
+  gint64 before;
+  gint64 after;
+  guint64 released;
+
+  g_return_val_if_fail (INDICATOR_IS_POWER_MEMORY_PRESSURE (self), 0);
+
+  p = get_priv (self);
+  before = get_resident_bytes ();
+
+  g_signal_emit (self, signals[SIGNAL_SHED], 0, level);
+
+  /* Return the freed heap to the kernel. This also covers the pages
+     freed in the payload worker threads' arenas, which glibc would
+     otherwise keep until they're reused. */
+#ifdef __GLIBC__
+  malloc_trim (0);
+#endif
+
+  after = get_resident_bytes ();
+  released = (before > after) && (after >= 0) ? (guint64)(before - after) : 0;
+
+  g_debug ("Low memory warning (level %d): released %" G_GUINT64_FORMAT " bytes",
+           (int)level, released);
+
+  if (released > 0)
+    {
+      p->bytes_released += released;
+      g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_BYTES_RELEASED]);
+    }
+
+  return released;
+}
+
+guint64
+indicator_power_memory_pressure_get_bytes_released (IndicatorPowerMemoryPressure * self)
+{
+  g_return_val_if_fail (INDICATOR_IS_POWER_MEMORY_PRESSURE (self), 0);
+
+  return get_priv (self)->bytes_released;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __INDICATOR_POWER_MEMORY_PRESSURE_H__
+#define __INDICATOR_POWER_MEMORY_PRESSURE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* standard GObject macros */
+#define INDICATOR_POWER_MEMORY_PRESSURE(o)    (G_TYPE_CHECK_INSTANCE_CAST ((o), INDICATOR_TYPE_POWER_MEMORY_PRESSURE, IndicatorPowerMemoryPressure))
+#define INDICATOR_TYPE_POWER_MEMORY_PRESSURE  (indicator_power_memory_pressure_get_type())
+#define INDICATOR_IS_POWER_MEMORY_PRESSURE(o) (G_TYPE_CHECK_INSTANCE_TYPE ((o), INDICATOR_TYPE_POWER_MEMORY_PRESSURE))
+
+typedef struct _IndicatorPowerMemoryPressure      IndicatorPowerMemoryPressure;
+typedef struct _IndicatorPowerMemoryPressureClass IndicatorPowerMemoryPressureClass;
+
+/* signal keys */
+#define INDICATOR_POWER_MEMORY_PRESSURE_SIGNAL_SHED "shed"
+
+/* property keys */
+#define INDICATOR_POWER_MEMORY_PRESSURE_PROP_MEMORY_MONITOR "memory-monitor"
+#define INDICATOR_POWER_MEMORY_PRESSURE_PROP_BYTES_RELEASED "bytes-released"
+
+/**
+ * Gives memory back when the system is short of it.
+ *
+ * On each of the GMemoryMonitor's low-memory warnings, the "shed" signal
+ * asks the owners of rebuildable caches to drop them. Then the freed heap
+ * is trimmed so that it goes back to the kernel, and the drop in resident
+ * size is added to the "bytes-released" property.
+ */
+struct _IndicatorPowerMemoryPressure
+{
+  /*< private >*/
+  GObject parent;
+};
+
+struct _IndicatorPowerMemoryPressureClass
+{
+  GObjectClass parent_class;
+
+  /* signals */
+  void (*shed) (IndicatorPowerMemoryPressure * self,
+                GMemoryMonitorWarningLevel     level);
+};
+
+/***
+****
+***/
+
+GType indicator_power_memory_pressure_get_type (void);
+
+/**
+ * @monitor: the GMemoryMonitor to listen to, or NULL for the default one
+ */
+IndicatorPowerMemoryPressure * indicator_power_memory_pressure_new (GMemoryMonitor * monitor);
+
+/**
+ * Sheds caches and trims the heap as if @level had just been reported.
+ *
+ * Returns: how many bytes of resident memory were released
+ */
+guint64 indicator_power_memory_pressure_shed (IndicatorPowerMemoryPressure * self,
+                                              GMemoryMonitorWarningLevel     level);
+
+/**
+ * Returns: the total bytes released since @self was created
+ */
+guint64 indicator_power_memory_pressure_get_bytes_released (IndicatorPowerMemoryPressure * self);
+
+G_END_DECLS
+
+#endif /* __INDICATOR_POWER_MEMORY_PRESSURE_H__ */
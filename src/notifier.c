@@ -22,15 +22,17 @@
 #include "datafiles.h"
 
 #ifdef LOMIRI_FEATURES_ENABLED
-    #include "dbus-accounts-sound.h"
+    #include <unistd.h> /* getuid() */
 #endif
 
 #ifndef LOMIRI_SOUNDSDIR
     #define LOMIRI_SOUNDSDIR ""
 #endif
 
-#include "dbus-battery.h"
+#include "dbus-introspection.h"
+#include "dbus-properties.h"
 #include "dbus-shared.h"
+#include "device-table.h"
 #include "notifier.h"
 #include "utils.h"
 
@@ -40,15 +42,6 @@
 
 #include <stdint.h> /* UINT32_MAX */
 
-typedef enum
-{
-  POWER_LEVEL_CRITICAL,
-  POWER_LEVEL_VERY_LOW,
-  POWER_LEVEL_LOW,
-  POWER_LEVEL_OK
-}
-PowerLevel;
-
 /**
 ***  GObject Properties
 **/
@@ -78,21 +71,24 @@ typedef struct
      See indicator_power_service_choose_primary_device() and
      bug #880881 */
   IndicatorPowerDevice * battery;
-  PowerLevel power_level;
+  IndicatorPowerLevel power_level;
   gboolean discharging;
 
   NotifyNotification * notify_notification;
 
   GDBusConnection * bus;
-  DbusBattery * dbus_battery; /* org.ayatana.indicator.power.Battery skeleton */
+  IndicatorPowerDBusProperties * battery_props; /* org.ayatana.indicator.power.Battery */
 
   gboolean caps_queried;
   gboolean actions_supported;
 
   GCancellable * cancellable;
   #ifdef LOMIRI_FEATURES_ENABLED
-  DbusAccountsServiceSound * accounts_service_sound_proxy;
-  gboolean accounts_service_sound_proxy_pending;
+  GDBusConnection * system_bus;
+  gchar * accounts_path;
+  guint accounts_sound_subscription;
+  gboolean accounts_sound_pending;
+  gboolean silent_mode;
   #endif
 }
 IndicatorPowerNotifierPrivate;
@@ -110,41 +106,24 @@ G_DEFINE_TYPE_WITH_PRIVATE(IndicatorPowerNotifier,
 ***/
 
 static const char *
-power_level_to_dbus_string (const PowerLevel power_level)
+power_level_to_dbus_string (const IndicatorPowerLevel power_level)
 {
   switch (power_level)
     {
-      case POWER_LEVEL_LOW:      return POWER_LEVEL_STR_LOW;
-      case POWER_LEVEL_VERY_LOW: return POWER_LEVEL_STR_VERY_LOW;
-      case POWER_LEVEL_CRITICAL: return POWER_LEVEL_STR_CRITICAL;
-      default:                   return POWER_LEVEL_STR_OK;
+      case INDICATOR_POWER_LEVEL_LOW:      return POWER_LEVEL_STR_LOW;
+      case INDICATOR_POWER_LEVEL_VERY_LOW: return POWER_LEVEL_STR_VERY_LOW;
+      case INDICATOR_POWER_LEVEL_CRITICAL: return POWER_LEVEL_STR_CRITICAL;
+      default:                             return POWER_LEVEL_STR_OK;
     }
 }
 
-static PowerLevel
+static IndicatorPowerLevel
 get_battery_power_level (IndicatorPowerDevice * battery)
 {
-  static const double percent_critical = 2.0;
-  static const double percent_very_low = 5.0;
-  static const double percent_low = 10.0;
-  gdouble p;
-  PowerLevel ret;
-
-  g_return_val_if_fail(battery != NULL, POWER_LEVEL_OK);
-  g_return_val_if_fail(indicator_power_device_get_kind(battery) == UP_DEVICE_KIND_BATTERY, POWER_LEVEL_OK);
-
-  p = indicator_power_device_get_percentage(battery);
-
-  if (p <= percent_critical)
-    ret = POWER_LEVEL_CRITICAL;
-  else if (p <= percent_very_low)
-    ret = POWER_LEVEL_VERY_LOW;
-  else if (p <= percent_low)
-    ret = POWER_LEVEL_LOW;
-  else
-    ret = POWER_LEVEL_OK;
+  g_return_val_if_fail(battery != NULL, INDICATOR_POWER_LEVEL_OK);
+  g_return_val_if_fail(indicator_power_device_get_kind(battery) == UP_DEVICE_KIND_BATTERY, INDICATOR_POWER_LEVEL_OK);
 
-  return ret;
+  return indicator_power_device_table_get_power_level (indicator_power_device_get_percentage (battery));
 }
 
 /***
@@ -152,50 +131,154 @@ get_battery_power_level (IndicatorPowerDevice * battery)
 ***/
 
 #ifdef LOMIRI_FEATURES_ENABLED
+
+#define ACCOUNTS_NAME "org.freedesktop.Accounts"
+#define ACCOUNTS_SOUND_INTERFACE "com.lomiri.touch.AccountsService.Sound"
+
 static void
-on_sound_proxy_ready (GObject      * source_object G_GNUC_UNUSED,
-                      GAsyncResult * res,
-                      gpointer       gself)
+on_silent_mode_got (GObject      * source_object,
+                    GAsyncResult * res,
+                    gpointer       gself)
 {
   GError * error;
-  error = NULL;
+  GVariant * reply;
 
-  DbusAccountsServiceSound * proxy;
-  proxy = dbus_accounts_service_sound_proxy_new_for_bus_finish (res, &error);
+  error = NULL;
+  reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION(source_object), res, &error);
 
   if (error != NULL)
     {
       if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
         {
-          get_priv(gself)->accounts_service_sound_proxy_pending = FALSE;
-          g_debug("%s Couldn't find accounts service sound proxy: %s", G_STRLOC, error->message);
+          get_priv(gself)->accounts_sound_pending = FALSE;
+          g_debug("%s Couldn't get accounts service silent mode: %s", G_STRLOC, error->message);
         }
 
       g_clear_error(&error);
     }
   else
     {
-      IndicatorPowerNotifier * const self = INDICATOR_POWER_NOTIFIER(gself);
-      priv_t * const p = get_priv (self);
-      g_clear_object (&p->accounts_service_sound_proxy);
-      p->accounts_service_sound_proxy = proxy;
-      p->accounts_service_sound_proxy_pending = FALSE;
+      priv_t * const p = get_priv (INDICATOR_POWER_NOTIFIER(gself));
+      GVariant * v;
+
+      g_variant_get (reply, "(v)", &v);
+      if (g_variant_is_of_type (v, G_VARIANT_TYPE_BOOLEAN))
+        p->silent_mode = g_variant_get_boolean (v);
+      p->accounts_sound_pending = FALSE;
+
+      g_variant_unref (v);
+      g_variant_unref (reply);
+    }
+}
+
+static void
+on_accounts_sound_properties_changed (GDBusConnection * connection     G_GNUC_UNUSED,
+                                      const gchar     * sender_name    G_GNUC_UNUSED,
+                                      const gchar     * object_path    G_GNUC_UNUSED,
+                                      const gchar     * interface_name G_GNUC_UNUSED,
+                                      const gchar     * signal_name    G_GNUC_UNUSED,
+                                      GVariant        * parameters,
+                                      gpointer          gself)
+{
+  priv_t * const p = get_priv (INDICATOR_POWER_NOTIFIER(gself));
+  const gchar * iface;
+  GVariant * changed;
+  const gchar ** invalidated;
+  gboolean silent;
+
+  g_variant_get (parameters, "(&s@a{sv}^a&s)", &iface, &changed, &invalidated);
+
+  if (!g_strcmp0 (iface, ACCOUNTS_SOUND_INTERFACE))
+    {
+      if (g_variant_lookup (changed, "SilentMode", "b", &silent))
+        {
+          p->silent_mode = silent;
+        }
+      else if (g_strv_contains (invalidated, "SilentMode"))
+        {
+          g_dbus_connection_call (p->system_bus,
+                                  ACCOUNTS_NAME,
+                                  p->accounts_path,
+                                  "org.freedesktop.DBus.Properties",
+                                  "Get",
+                                  g_variant_new ("(ss)", ACCOUNTS_SOUND_INTERFACE, "SilentMode"),
+                                  G_VARIANT_TYPE ("(v)"),
+                                  G_DBUS_CALL_FLAGS_NONE,
+                                  -1,
+                                  p->cancellable,
+                                  on_silent_mode_got,
+                                  gself);
+        }
     }
+
+  g_free (invalidated);
+  g_variant_unref (changed);
 }
 
+static void
+on_system_bus_ready (GObject      * source_object G_GNUC_UNUSED,
+                     GAsyncResult * res,
+                     gpointer       gself)
+{
+  GError * error;
+  GDBusConnection * system_bus;
+
+  error = NULL;
+  system_bus = g_bus_get_finish (res, &error);
+
+  if (error != NULL)
+    {
+      if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          get_priv(gself)->accounts_sound_pending = FALSE;
+          g_debug("%s Couldn't get the system bus: %s", G_STRLOC, error->message);
+        }
+
+      g_clear_error(&error);
+    }
+  else
+    {
+      priv_t * const p = get_priv (INDICATOR_POWER_NOTIFIER(gself));
+
+      p->system_bus = system_bus;
+      p->accounts_sound_subscription = g_dbus_connection_signal_subscribe (
+        system_bus,
+        ACCOUNTS_NAME,
+        "org.freedesktop.DBus.Properties",
+        "PropertiesChanged",
+        p->accounts_path,
+        ACCOUNTS_SOUND_INTERFACE,
+        G_DBUS_SIGNAL_FLAGS_NONE,
+        on_accounts_sound_properties_changed,
+        gself,
+        NULL);
+
+      g_dbus_connection_call (system_bus,
+                              ACCOUNTS_NAME,
+                              p->accounts_path,
+                              "org.freedesktop.DBus.Properties",
+                              "Get",
+                              g_variant_new ("(ss)", ACCOUNTS_SOUND_INTERFACE, "SilentMode"),
+                              G_VARIANT_TYPE ("(v)"),
+                              G_DBUS_CALL_FLAGS_NONE,
+                              -1,
+                              p->cancellable,
+                              on_silent_mode_got,
+                              gself);
+    }
+}
 
 static gboolean
 silent_mode (IndicatorPowerNotifier * self)
 {
   priv_t * const p = get_priv (self);
 
-  /* if we don't have a proxy yet, assume we're in silent mode
-     as a "do no harm" level of response */
-  if (p->accounts_service_sound_proxy_pending)
+  /* if we haven't heard from accounts service yet, assume we're
+     in silent mode as a "do no harm" level of response */
+  if (p->accounts_sound_pending)
     return TRUE;
 
-  return (p->accounts_service_sound_proxy != NULL)
-      && dbus_accounts_service_sound_get_silent_mode(p->accounts_service_sound_proxy);
+  return p->silent_mode;
 }
 #endif
 
@@ -210,7 +293,7 @@ on_notify_notification_finalized (gpointer gself, GObject * dead)
   priv_t * const p = get_priv(self);
   g_return_if_fail ((void*)(p->notify_notification) == (void*)dead);
   p->notify_notification = NULL;
-  dbus_battery_set_is_warning (p->dbus_battery, FALSE);
+  indicator_power_dbus_properties_set (p->battery_props, "IsWarning", g_variant_new_boolean (FALSE));
 }
 
 static void
@@ -232,7 +315,7 @@ notification_clear (IndicatorPowerNotifier * self)
         }
 
       p->notify_notification = NULL;
-      dbus_battery_set_is_warning (p->dbus_battery, FALSE);
+      indicator_power_dbus_properties_set (p->battery_props, "IsWarning", g_variant_new_boolean (FALSE));
     }
 }
 
@@ -290,14 +373,14 @@ notification_show(IndicatorPowerNotifier * self)
   const char * icon_name;
   NotifyNotification * nn;
   GError * error;
-  const PowerLevel power_level = get_battery_power_level(p->battery);
+  const IndicatorPowerLevel power_level = get_battery_power_level(p->battery);
 
   notification_clear(self);
 
-  g_return_if_fail(power_level != POWER_LEVEL_OK);
+  g_return_if_fail(power_level != INDICATOR_POWER_LEVEL_OK);
 
   /* create the notification */
-  title = power_level == POWER_LEVEL_LOW
+  title = power_level == INDICATOR_POWER_LEVEL_LOW
         ? _("Battery Low")
         : _("Battery Critical");
   pct = indicator_power_device_get_percentage(p->battery);
@@ -347,7 +430,7 @@ notification_show(IndicatorPowerNotifier * self)
       p->notify_notification = nn;
       g_signal_connect(nn, "closed", G_CALLBACK(g_object_unref), NULL);
       g_object_weak_ref(G_OBJECT(nn), on_notify_notification_finalized, self);
-      dbus_battery_set_is_warning (p->dbus_battery, TRUE);
+      indicator_power_dbus_properties_set (p->battery_props, "IsWarning", g_variant_new_boolean (TRUE));
     }
   else
     {
@@ -365,8 +448,8 @@ static void
 on_battery_property_changed (IndicatorPowerNotifier * self)
 {
   priv_t * p;
-  PowerLevel old_power_level;
-  PowerLevel new_power_level;
+  IndicatorPowerLevel old_power_level;
+  IndicatorPowerLevel new_power_level;
   gboolean old_discharging;
   gboolean new_discharging;
 
@@ -384,16 +467,17 @@ on_battery_property_changed (IndicatorPowerNotifier * self)
      a) it's already discharging, and its PowerLevel worsens, OR
      b) it's already got a bad PowerLevel and its state becomes 'discharging */
   if ((new_discharging && (old_power_level > new_power_level)) ||
-      ((new_power_level != POWER_LEVEL_OK) && new_discharging && !old_discharging))
+      ((new_power_level != INDICATOR_POWER_LEVEL_OK) && new_discharging && !old_discharging))
     {
       notification_show (self);
     }
-  else if (!new_discharging || (new_power_level == POWER_LEVEL_OK))
+  else if (!new_discharging || (new_power_level == INDICATOR_POWER_LEVEL_OK))
     {
       notification_clear (self);
     }
 
-  dbus_battery_set_power_level (p->dbus_battery, power_level_to_dbus_string (new_power_level));
+  indicator_power_dbus_properties_set (p->battery_props, "PowerLevel",
+                                       g_variant_new_string (power_level_to_dbus_string (new_power_level)));
   p->power_level = new_power_level;
   p->discharging = new_discharging;
 }
@@ -456,10 +540,16 @@ my_dispose (GObject * o)
   indicator_power_notifier_set_bus (self, NULL);
   notification_clear (self);
   indicator_power_notifier_set_battery (self, NULL);
-  g_clear_object (&p->dbus_battery);
+  g_clear_pointer (&p->battery_props, indicator_power_dbus_properties_free);
 
   #ifdef LOMIRI_FEATURES_ENABLED
-  g_clear_object (&p->accounts_service_sound_proxy);
+  if (p->accounts_sound_subscription != 0)
+    {
+      g_dbus_connection_signal_unsubscribe (p->system_bus, p->accounts_sound_subscription);
+      p->accounts_sound_subscription = 0;
+    }
+  g_clear_object (&p->system_bus);
+  g_clear_pointer (&p->accounts_path, g_free);
   #endif
 
   G_OBJECT_CLASS (indicator_power_notifier_parent_class)->dispose (o);
@@ -484,11 +574,13 @@ indicator_power_notifier_init (IndicatorPowerNotifier * self)
 {
   priv_t * const p = get_priv (self);
 
-  /* bind the read-only properties so they'll get pushed to the bus */
-
-  p->dbus_battery = dbus_battery_skeleton_new ();
+  p->battery_props = indicator_power_dbus_properties_new (INDICATOR_POWER_BATTERY_INTROSPECTION_XML, NULL, NULL);
+  indicator_power_dbus_properties_set (p->battery_props, "PowerLevel",
+                                       g_variant_new_string (power_level_to_dbus_string (INDICATOR_POWER_LEVEL_OK)));
+  indicator_power_dbus_properties_set (p->battery_props, "IsWarning", g_variant_new_boolean (FALSE));
+  indicator_power_notifier_set_suspend_history (self, g_variant_new_array (G_VARIANT_TYPE ("(xxxddd)"), NULL, 0));
 
-  p->power_level = POWER_LEVEL_OK;
+  p->power_level = INDICATOR_POWER_LEVEL_OK;
 
   p->cancellable = g_cancellable_new();
 
@@ -496,17 +588,9 @@ indicator_power_notifier_init (IndicatorPowerNotifier * self)
     g_critical("Unable to initialize libnotify! Notifications might not be shown.");
 
   #ifdef LOMIRI_FEATURES_ENABLED
-  p->accounts_service_sound_proxy_pending = TRUE;
-  gchar* object_path = g_strdup_printf("/org/freedesktop/Accounts/User%lu", (gulong)getuid());
-  dbus_accounts_service_sound_proxy_new_for_bus(
-    G_BUS_TYPE_SYSTEM,
-    G_DBUS_PROXY_FLAGS_GET_INVALIDATED_PROPERTIES,
-    "org.freedesktop.Accounts",
-    object_path,
-    p->cancellable,
-    on_sound_proxy_ready,
-    self);
-  g_clear_pointer(&object_path, g_free);
+  p->accounts_sound_pending = TRUE;
+  p->accounts_path = g_strdup_printf("/org/freedesktop/Accounts/User%lu", (gulong)getuid());
+  g_bus_get (G_BUS_TYPE_SYSTEM, p->cancellable, on_system_bus_ready, self);
   #endif
 }
 
@@ -560,7 +644,8 @@ indicator_power_notifier_set_battery (IndicatorPowerNotifier * self,
     {
       g_signal_handlers_disconnect_by_data (p->battery, self);
       g_clear_object (&p->battery);
-      dbus_battery_set_power_level (p->dbus_battery, power_level_to_dbus_string (POWER_LEVEL_OK));
+      indicator_power_dbus_properties_set (p->battery_props, "PowerLevel",
+                                           g_variant_new_string (power_level_to_dbus_string (INDICATOR_POWER_LEVEL_OK)));
       notification_clear (self);
     }
 
@@ -580,7 +665,6 @@ indicator_power_notifier_set_bus (IndicatorPowerNotifier * self,
                                   GDBusConnection        * bus)
 {
   priv_t * p;
-  GDBusInterfaceSkeleton * skel;
 
   g_return_if_fail(INDICATOR_IS_POWER_NOTIFIER(self));
   g_return_if_fail((bus == NULL) || G_IS_DBUS_CONNECTION(bus));
@@ -590,12 +674,9 @@ indicator_power_notifier_set_bus (IndicatorPowerNotifier * self,
   if (p->bus == bus)
     return;
 
-  skel = G_DBUS_INTERFACE_SKELETON(p->dbus_battery);
-
   if (p->bus != NULL)
     {
-      if (skel != NULL)
-        g_dbus_interface_skeleton_unexport (skel);
+      indicator_power_dbus_properties_unexport (p->battery_props);
 
       g_clear_object (&p->bus);
     }
@@ -607,10 +688,10 @@ indicator_power_notifier_set_bus (IndicatorPowerNotifier * self,
       p->bus = g_object_ref (bus);
 
       error = NULL;
-      if (!g_dbus_interface_skeleton_export(skel,
-                                            bus,
-                                            BUS_PATH"/Battery",
-                                            &error))
+      if (!indicator_power_dbus_properties_export (p->battery_props,
+                                                   bus,
+                                                   BUS_PATH"/Battery",
+                                                   &error))
         {
           g_warning ("Unable to export LowBattery properties: %s", error->message);
           g_error_free (error);
@@ -618,6 +699,16 @@ indicator_power_notifier_set_bus (IndicatorPowerNotifier * self,
     }
 }
 
+void
+indicator_power_notifier_set_suspend_history (IndicatorPowerNotifier * self,
+                                              GVariant               * history)
+{
+  g_return_if_fail(INDICATOR_IS_POWER_NOTIFIER(self));
+  g_return_if_fail(history != NULL);
+
+  indicator_power_dbus_properties_set (get_priv (self)->battery_props, "SuspendHistory", history);
+}
+
 const char *
 indicator_power_notifier_get_power_level (IndicatorPowerDevice * battery)
 {
@@ -63,6 +63,14 @@ void indicator_power_notifier_set_bus (IndicatorPowerNotifier  * self,
 void indicator_power_notifier_set_battery (IndicatorPowerNotifier  * self,
                                            IndicatorPowerDevice    * battery);
 
+/**
+ * Publishes @history as the Battery interface's SuspendHistory property.
+ * @history is an a(xxxddd) array, as described in
+ * data/org.ayatana.indicator.power.Battery.xml. A floating ref is sunk.
+ */
+void indicator_power_notifier_set_suspend_history (IndicatorPowerNotifier * self,
+                                                   GVariant               * history);
+
 #define POWER_LEVEL_STR_OK "ok"
 #define POWER_LEVEL_STR_LOW "low"
 #define POWER_LEVEL_STR_VERY_LOW "very_low"
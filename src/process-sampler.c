@@ -0,0 +1,353 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "process-sampler.h"
+
+/* Keeping a stat file open saves an openat() per process per sample,
+   but the service shouldn't spend its whole fd budget on it.
+   Processes beyond this are opened and closed on each sample. */
+#define MAX_OPEN_STAT_FDS 256
+
+struct entry
+{
+  gint pid;
+  int fd; /* the process's stat file, or -1 */
+  guint generation; /* the last sample this process was seen in */
+  gboolean primed; /* TRUE once ticks holds a real previous value */
+  guint64 ticks; /* utime + stime */
+  guint64 delta; /* ticks since the previous sample */
+  gchar name[16];
+};
+
+struct _IndicatorPowerProcessSampler
+{
+  DIR * proc_dir;
+  long clock_ticks_per_sec;
+
+  /* pid --> struct entry */
+  GHashTable * entries;
+  guint generation;
+  guint n_open_fds;
+
+  gint64 prev_sample_time;
+  gint64 last_sample_time;
+
+  /* reused for every stat file */
+  char buf[1024];
+};
+
+/***
+****
+***/
+
+static gint
+parse_pid (const char * str)
+{
+  gint pid = 0;
+
+  if (!g_ascii_isdigit (*str))
+    return 0;
+
+  for ( ; *str; ++str)
+    {
+      if (!g_ascii_isdigit (*str) || (pid > (G_MAXINT - 9) / 10))
+        return 0;
+
+      pid = pid*10 + (*str - '0');
+    }
+
+  return pid;
+}
+
+static guint64
+parse_u64 (const char ** pstr, const char * end)
+{
+  const char * str = *pstr;
+  guint64 u = 0;
+
+  while ((str < end) && g_ascii_isdigit (*str))
+    u = u*10 + (guint64)(*str++ - '0');
+
+  *pstr = str;
+  return u;
+}
+
+/* Parses the name and utime + stime out of a /proc/<pid>/stat line.
+   The name is in parentheses and may itself contain spaces or parentheses,
+   so the fields after it are found by searching back for the last ')'. */
+static gboolean
+parse_stat (const char * buf, gsize len, gchar name[16], guint64 * ticks)
+{
+  const char * end = buf + len;
+  const char * open_paren;
+  const char * close_paren;
+  const char * str;
+  guint64 utime;
+  guint64 stime;
+  gsize name_len;
+  int field;
+
+  if ((open_paren = memchr (buf, '(', len)) == NULL)
+    return FALSE;
+
+  for (close_paren = end-1; close_paren > open_paren; --close_paren)
+    if (*close_paren == ')')
+      break;
+  if (close_paren == open_paren)
+    return FALSE;
+
+  name_len = MIN ((gsize)(close_paren - open_paren - 1), 15);
+  memcpy (name, open_paren+1, name_len);
+  name[name_len] = '\0';
+
+  /* skip to field 14, utime. Field 3, state, follows the ") " */
+  for (str=close_paren+2, field=3; (str < end) && (field < 14); ++str)
+    if (*str == ' ')
+      ++field;
+  if (field != 14)
+    return FALSE;
+
+  utime = parse_u64 (&str, end);
+  if ((str >= end) || (*str != ' '))
+    return FALSE;
+  ++str;
+  stime = parse_u64 (&str, end);
+
+  *ticks = utime + stime;
+  return TRUE;
+}
+
+static void
+close_entry (IndicatorPowerProcessSampler * self, struct entry * e)
+{
+  if (e->fd != -1)
+    {
+      close (e->fd);
+      e->fd = -1;
+      --self->n_open_fds;
+    }
+}
+
+static gboolean
+read_entry (IndicatorPowerProcessSampler * self, struct entry * e)
+{
+  gboolean keep_open = TRUE;
+  gboolean ok;
+  guint64 ticks;
+  gssize n;
+
+  if (e->fd == -1)
+    {
+      char path[32];
+
+      g_snprintf (path, sizeof(path), "%d/stat", e->pid);
+      e->fd = openat (dirfd (self->proc_dir), path, O_RDONLY|O_CLOEXEC);
+      if (e->fd == -1)
+        return FALSE;
+
+      if (self->n_open_fds < MAX_OPEN_STAT_FDS)
+        ++self->n_open_fds;
+      else
+        keep_open = FALSE;
+    }
+
+  n = pread (e->fd, self->buf, sizeof(self->buf)-1, 0);
+  ok = (n > 0) && parse_stat (self->buf, (gsize)n, e->name, &ticks);
+
+  if (!keep_open)
+    {
+      close (e->fd);
+      e->fd = -1;
+    }
+
+  if (!ok)
+    return FALSE;
+
+  /* a process first seen in this sample has no baseline to diff against */
+  e->delta = (e->primed && (ticks >= e->ticks)) ? ticks - e->ticks : 0;
+  e->ticks = ticks;
+  e->primed = TRUE;
+  return TRUE;
+}
+
+static gboolean
+remove_stale_entry (gpointer key G_GNUC_UNUSED, gpointer value, gpointer gself)
+{
+  IndicatorPowerProcessSampler * self = gself;
+  struct entry * e = value;
+
+  if (e->generation == self->generation)
+    return FALSE;
+
+  close_entry (self, e);
+  g_free (e);
+  return TRUE;
+}
+
+/***
+****  Public API
+***/
+
+IndicatorPowerProcessSampler *
+indicator_power_process_sampler_new (const char * proc_dir)
+{
+  IndicatorPowerProcessSampler * self;
+  DIR * dir;
+
+  if (proc_dir == NULL)
+    proc_dir = "/proc";
+
+  if ((dir = opendir (proc_dir)) == NULL)
+    {
+      g_warning ("Unable to open '%s': %s", proc_dir, g_strerror (errno));
+      return NULL;
+    }
+
+  self = g_new0 (IndicatorPowerProcessSampler, 1);
+  self->proc_dir = dir;
+  self->clock_ticks_per_sec = sysconf (_SC_CLK_TCK);
+  self->entries = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  return self;
+}
+
+void
+indicator_power_process_sampler_free (IndicatorPowerProcessSampler * self)
+{
+  if (self == NULL)
+    return;
+
+  /* everything is stale now */
+  ++self->generation;
+  g_hash_table_foreach_remove (self->entries, remove_stale_entry, self);
+  g_hash_table_destroy (self->entries);
+  closedir (self->proc_dir);
+  g_free (self);
+}
+
+guint
+indicator_power_process_sampler_sample (IndicatorPowerProcessSampler * self)
+{
+  struct dirent * de;
+
+  g_return_val_if_fail (self != NULL, 0);
+
+  ++self->generation;
+
+  rewinddir (self->proc_dir);
+  while ((de = readdir (self->proc_dir)))
+    {
+      struct entry * e;
+      const gint pid = parse_pid (de->d_name);
+
+      if (pid <= 0)
+        continue;
+
+      e = g_hash_table_lookup (self->entries, GINT_TO_POINTER(pid));
+      if (e == NULL)
+        {
+          e = g_new0 (struct entry, 1);
+          e->pid = pid;
+          e->fd = -1;
+          g_hash_table_insert (self->entries, GINT_TO_POINTER(pid), e);
+        }
+
+      /* if the read fails, the process exited (or its pid was reused
+         and our fd points at the old one). Either way, it's stale. */
+      if (read_entry (self, e))
+        e->generation = self->generation;
+    }
+
+  g_hash_table_foreach_remove (self->entries, remove_stale_entry, self);
+
+  self->prev_sample_time = self->last_sample_time;
+  self->last_sample_time = g_get_monotonic_time ();
+
+  return g_hash_table_size (self->entries);
+}
+
+void
+indicator_power_process_sampler_shed (IndicatorPowerProcessSampler * self)
+{
+  g_return_if_fail (self != NULL);
+
+  /* everything is stale now */
+  ++self->generation;
+  g_hash_table_foreach_remove (self->entries, remove_stale_entry, self);
+
+  self->prev_sample_time = 0;
+  self->last_sample_time = 0;
+}
+
+guint
+indicator_power_process_sampler_get_top (const IndicatorPowerProcessSampler * self,
+                                         IndicatorPowerProcessUsage         * top,
+                                         guint                                n)
+{
+  GHashTableIter iter;
+  gpointer value;
+  gdouble interval_sec;
+  guint n_top = 0;
+  guint i;
+
+  g_return_val_if_fail (self != NULL, 0);
+  g_return_val_if_fail ((top != NULL) || (n == 0), 0);
+
+  if (n == 0)
+    return 0;
+
+  /* insertion sort into the caller's array, busiest first */
+  g_hash_table_iter_init (&iter, self->entries);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      const struct entry * e = value;
+
+      if ((e->delta == 0) || ((n_top == n) && (e->delta <= top[n-1].ticks)))
+        continue;
+
+      i = MIN (n_top, n-1);
+      while ((i > 0) && (top[i-1].ticks < e->delta))
+        {
+          top[i] = top[i-1];
+          --i;
+        }
+
+      top[i].pid = e->pid;
+      top[i].ticks = e->delta;
+      memcpy (top[i].name, e->name, sizeof(top[i].name));
+      n_top = MIN (n_top+1, n);
+    }
+
+  interval_sec = self->prev_sample_time != 0
+               ? (self->last_sample_time - self->prev_sample_time) / (gdouble)G_USEC_PER_SEC
+               : 0;
+
+  for (i=0; i<n_top; ++i)
+    {
+      if ((interval_sec > 0) && (self->clock_ticks_per_sec > 0))
+        top[i].cpu_percent = 100.0 * top[i].ticks / self->clock_ticks_per_sec / interval_sec;
+      else
+        top[i].cpu_percent = 0;
+    }
+
+  return n_top;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __INDICATOR_POWER_PROCESS_SAMPLER_H__
+#define __INDICATOR_POWER_PROCESS_SAMPLER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Samples per-process CPU time from /proc/<pid>/stat and reports which
+ * processes used the most CPU between the two most recent samples.
+ *
+ * It's meant to be cheap enough to run every couple of seconds:
+ * the /proc directory and the stat files of the processes it's
+ * tracking are kept open between samples, and everything is parsed
+ * from one reused buffer.
+ */
+typedef struct _IndicatorPowerProcessSampler IndicatorPowerProcessSampler;
+
+typedef struct
+{
+  gint pid;
+
+  /* the process's comm, e.g. "firefox" */
+  gchar name[16];
+
+  /* clock ticks of user + system time since the previous sample */
+  guint64 ticks;
+
+  /* ticks as a percentage of one CPU over the sampling interval */
+  gdouble cpu_percent;
+}
+IndicatorPowerProcessUsage;
+
+/**
+ * @proc_dir: the procfs mount to sample, or NULL for "/proc"
+ *
+ * Returns: a new sampler, or NULL if @proc_dir couldn't be opened
+ */
+IndicatorPowerProcessSampler * indicator_power_process_sampler_new (const char * proc_dir);
+
+void indicator_power_process_sampler_free (IndicatorPowerProcessSampler * sampler);
+
+/**
+ * Takes a new sample and diffs it against the previous one.
+ *
+ * Returns: the number of processes being tracked
+ */
+guint indicator_power_process_sampler_sample (IndicatorPowerProcessSampler * sampler);
+
+/**
+ * Drops the per-process entries and closes the stat files kept open
+ * between samples. The next sample starts over as a new baseline.
+ */
+void indicator_power_process_sampler_shed (IndicatorPowerProcessSampler * sampler);
+
+/**
+ * Fills @top with up to @n processes that used CPU time between the
+ * last two samples, busiest first.
+ *
+ * Returns: the number of entries filled in
+ */
+guint indicator_power_process_sampler_get_top (const IndicatorPowerProcessSampler * sampler,
+                                               IndicatorPowerProcessUsage         * top,
+                                               guint                                n);
+
+G_END_DECLS
+
+#endif /* __INDICATOR_POWER_PROCESS_SAMPLER_H__ */
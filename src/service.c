@@ -24,11 +24,18 @@
 #include <gio/gio.h>
 #include <ayatana/common/utils.h>
 #include "brightness.h"
+#include "dbus-introspection.h"
+#include "dbus-properties.h"
 #include "dbus-shared.h"
 #include "device.h"
 #include "device-provider.h"
+#include "device-provider-upower.h"
+#include "device-table.h"
+#include "memory-pressure.h"
 #include "notifier.h"
+#include "process-sampler.h"
 #include "service.h"
+#include "suspend-monitor.h"
 #include "flashlight.h"
 #include "utils.h"
 
@@ -38,6 +45,19 @@
 #define SETTINGS_SHOW_TIME_S "show-time"
 #define SETTINGS_ICON_POLICY_S "icon-policy"
 #define SETTINGS_SHOW_PERCENTAGE_S "show-percentage"
+#define SETTINGS_SHOW_POWER_IN_MENU_BAR_S "show-power-in-menu-bar"
+#define SETTINGS_TOP_CONSUMERS_S "top-consumers"
+#define SETTINGS_SHOW_SUSPEND_DRAIN_S "show-suspend-drain"
+
+/* the most processes the top-consumers section will list */
+#define TOP_CONSUMERS_MAX 10
+
+/* how often to sample /proc while the top-consumers section is live */
+#define TOP_CONSUMERS_INTERVAL_SEC 2
+
+/* a battery that would empty in under five hours is draining fast
+   enough that we sample even while the menu is closed */
+#define FAST_DRAIN_PERCENT_PER_HOUR 20.0
 
 enum
 {
@@ -53,6 +73,7 @@ enum
   PROP_BUS,
   PROP_DEVICE_PROVIDER,
   PROP_NOTIFIER,
+  PROP_THREADED_PAYLOADS,
   LAST_PROP
 };
 
@@ -63,6 +84,8 @@ enum
   SECTION_HEADER    = (1<<0),
   SECTION_DEVICES   = (1<<1),
   SECTION_SETTINGS  = (1<<2),
+  SECTION_CONSUMERS = (1<<3),
+  SECTION_SUSPEND   = (1<<4),
 };
 
 enum
@@ -124,6 +147,27 @@ struct _IndicatorPowerServicePrivate
 
   IndicatorPowerDeviceProvider * device_provider;
   IndicatorPowerNotifier * notifier;
+
+  /* when enabled, header and device-section payloads are built
+     in a worker thread. See request_payload() */
+  gboolean threaded_payloads;
+  guint payload_serial;
+  guint pending_payload_sections;
+
+  /* top energy consumers. /proc is only sampled while the menu
+     is open or the battery is draining fast.
+     See update_consumers_sampling() */
+  IndicatorPowerProcessSampler * sampler;
+  guint sampler_timer;
+  GSimpleAction * consumers_active_action;
+
+  /* battery drain while suspended */
+  IndicatorPowerSuspendMonitor * suspend_monitor;
+
+  /* drops our caches on low-memory warnings */
+  IndicatorPowerMemoryPressure * memory_pressure;
+
+  IndicatorPowerDBusProperties * diagnostics_props; /* org.ayatana.indicator.power.Diagnostics */
 };
 
 typedef IndicatorPowerServicePrivate priv_t;
@@ -140,26 +184,21 @@ G_DEFINE_TYPE_WITH_PRIVATE(IndicatorPowerService, indicator_power_service, G_TYP
 static int
 get_device_kind_weight (const IndicatorPowerDevice * device)
 {
-  UpDeviceKind kind;
-  static gboolean initialized = FALSE;
-  static int weights[UP_DEVICE_KIND_LAST];
+  const UpDeviceKind kind = indicator_power_device_get_kind (device);
 
-  kind = indicator_power_device_get_kind (device);
   g_return_val_if_fail (0<=kind && kind<UP_DEVICE_KIND_LAST, 0);
 
-  if (G_UNLIKELY(!initialized))
+  switch (kind)
     {
-      int i;
+      case UP_DEVICE_KIND_BATTERY:
+        return 2;
 
-      initialized = TRUE;
+      case UP_DEVICE_KIND_LINE_POWER:
+        return 0;
 
-      for (i=0; i<UP_DEVICE_KIND_LAST; i++)
-        weights[i] = 1;
-      weights[UP_DEVICE_KIND_BATTERY] = 2;
-      weights[UP_DEVICE_KIND_LINE_POWER] = 0;
+      default:
+        return 1;
     }
-
-  return weights[kind];
 }
 
 /* sort devices from most interesting to least interesting on this criteria:
@@ -168,7 +207,10 @@ get_device_kind_weight (const IndicatorPowerDevice * device)
    3. charging items from most time left to charge to least time left to charge
    4. charging items with an unknown time remaining
    5. discharging items with an unknown time remaining
-   6. batteries, then non-line power, then line-power */
+   6. batteries, then non-line power, then line-power
+
+   get_priority() in device-table.c encodes the same order as a sort key,
+   so a change here needs a matching change there. */
 static gint
 device_compare_func (gconstpointer ga, gconstpointer gb)
 {
@@ -445,29 +487,33 @@ should_be_visible (IndicatorPowerService * self)
   return visible;
 }
 
+/* Builds the header state from explicit inputs instead of from the service
+   so that it can run in a worker thread. See prepare_payload_thread() */
 static GVariant *
-create_header_state (IndicatorPowerService * self)
+create_header_state_for (const IndicatorPowerDevice * primary_device,
+                         gboolean                     visible,
+                         gboolean                     want_time,
+                         gboolean                     want_percent,
+                         gboolean                     want_power)
 {
   GVariantBuilder b;
-  const priv_t * const p = self->priv;
 
   g_variant_builder_init (&b, G_VARIANT_TYPE("a{sv}"));
 
   g_variant_builder_add (&b, "{sv}", "title", g_variant_new_string (_("Battery")));
 
   g_variant_builder_add (&b, "{sv}", "visible",
-                         g_variant_new_boolean (should_be_visible (self)));
+                         g_variant_new_boolean (visible));
 
-  if (p->primary_device != NULL)
+  if (primary_device != NULL)
     {
       char * title;
       GIcon * icon;
-      const gboolean want_time = g_settings_get_boolean (p->settings, SETTINGS_SHOW_TIME_S);
-      const gboolean want_percent = g_settings_get_boolean (p->settings, SETTINGS_SHOW_PERCENTAGE_S);
 
-      title = indicator_power_device_get_readable_title (p->primary_device,
+      title = indicator_power_device_get_readable_title (primary_device,
                                                          want_time,
-                                                         want_percent);
+                                                         want_percent,
+                                                         want_power);
       if (title)
         {
           if (*title)
@@ -476,9 +522,10 @@ create_header_state (IndicatorPowerService * self)
             g_free (title);
         }
 
-      title = indicator_power_device_get_accessible_title (p->primary_device,
+      title = indicator_power_device_get_accessible_title (primary_device,
                                                            want_time,
-                                                           want_percent);
+                                                           want_percent,
+                                                           want_power);
       if (title)
         {
           if (*title)
@@ -487,7 +534,7 @@ create_header_state (IndicatorPowerService * self)
             g_free (title);
         }
 
-      if ((icon = indicator_power_device_get_gicon (p->primary_device)))
+      if ((icon = indicator_power_device_get_gicon (primary_device)))
         {
           GVariant * serialized_icon = g_icon_serialize (icon);
 
@@ -504,6 +551,18 @@ create_header_state (IndicatorPowerService * self)
   return g_variant_builder_end (&b);
 }
 
+static GVariant *
+create_header_state (IndicatorPowerService * self)
+{
+  const priv_t * const p = self->priv;
+
+  return create_header_state_for (p->primary_device,
+                                  should_be_visible (self),
+                                  g_settings_get_boolean (p->settings, SETTINGS_SHOW_TIME_S),
+                                  g_settings_get_boolean (p->settings, SETTINGS_SHOW_PERCENTAGE_S),
+                                  g_settings_get_boolean (p->settings, SETTINGS_SHOW_POWER_IN_MENU_BAR_S));
+}
+
 
 /***
 ****
@@ -512,7 +571,11 @@ create_header_state (IndicatorPowerService * self)
 ***/
 
 static void
-append_device_to_menu (GMenu * menu, const IndicatorPowerDevice * device, int profile)
+append_device_to_menu (GMenu                           * menu,
+                       const IndicatorPowerDevice      * device,
+                       const IndicatorPowerDeviceTable * table,
+                       guint                             row,
+                       int                               profile)
 {
   const UpDeviceKind kind = indicator_power_device_get_kind (device);
 
@@ -528,7 +591,9 @@ append_device_to_menu (GMenu * menu, const IndicatorPowerDevice * device, int pr
 
     g_menu_item_set_attribute (item, "x-ayatana-type", "s", "org.ayatana.indicator.basic");
 
-    if ((icon = indicator_power_device_get_gicon (device)))
+    if ((icon = indicator_power_device_get_gicon_for_buckets (device,
+                                                              table->icon_indices[row],
+                                                              table->fallback_icon_indices[row])))
       {
         GVariant * serialized_icon = g_icon_serialize (icon);
 
@@ -555,18 +620,30 @@ append_device_to_menu (GMenu * menu, const IndicatorPowerDevice * device, int pr
 }
 
 
+/* The icon buckets for every device are computed in one batch pass */
 static GMenuModel *
-create_desktop_devices_section (IndicatorPowerService * self, int profile)
+create_desktop_devices_section_for (GList * devices, int profile)
 {
   GList * l;
+  guint row;
   GMenu * menu = g_menu_new ();
+  IndicatorPowerDeviceTable * table = indicator_power_device_table_new_from_list (devices);
+
+  indicator_power_device_table_compute (table);
 
-  for (l=self->priv->devices; l!=NULL; l=l->next)
-    append_device_to_menu (menu, l->data, profile);
+  for (l=devices, row=0; l!=NULL; l=l->next, ++row)
+    append_device_to_menu (menu, l->data, table, row, profile);
 
+  indicator_power_device_table_free (table);
   return G_MENU_MODEL (menu);
 }
 
+static GMenuModel *
+create_desktop_devices_section (IndicatorPowerService * self, int profile)
+{
+  return create_desktop_devices_section_for (self->priv->devices, profile);
+}
+
 /* https://wiki.ubuntu.com/Power#Phone
  * The spec also discusses including an item for any connected bluetooth
  * headset, but bluez doesn't appear to support Battery Level at this time */
@@ -587,6 +664,84 @@ create_phone_devices_section (IndicatorPowerService * self G_GNUC_UNUSED)
 }
 
 
+/***
+****
+****  TOP CONSUMERS SECTION
+****
+***/
+
+static GMenuModel *
+create_desktop_consumers_section (IndicatorPowerService * self)
+{
+  priv_t * p = self->priv;
+  GMenu * menu = g_menu_new ();
+  IndicatorPowerProcessUsage top[TOP_CONSUMERS_MAX];
+  guint n;
+  guint i;
+
+  if (p->sampler == NULL)
+    return G_MENU_MODEL (menu);
+
+  n = CLAMP (g_settings_get_int (p->settings, SETTINGS_TOP_CONSUMERS_S), 0, TOP_CONSUMERS_MAX);
+  n = indicator_power_process_sampler_get_top (p->sampler, top, n);
+
+  if (n > 0)
+    g_menu_append (menu, _("Top energy consumers"), NULL);
+
+  for (i=0; i<n; ++i)
+    {
+      /* TRANSLATORS: a process and its share of one CPU. Example: "firefox (12% CPU)" */
+      char * label = g_strdup_printf (_("%s (%.0lf%% CPU)"), top[i].name, top[i].cpu_percent);
+      g_menu_append (menu, label, NULL);
+      g_free (label);
+    }
+
+  return G_MENU_MODEL (menu);
+}
+
+/***
+****
+****  SUSPEND DRAIN SECTION
+****
+***/
+
+static GMenuModel *
+create_desktop_suspend_section (IndicatorPowerService * self)
+{
+  priv_t * p = self->priv;
+  GMenu * menu = g_menu_new ();
+  const IndicatorPowerSuspendRecord * history;
+  const IndicatorPowerSuspendRecord * last;
+  guint n = 0;
+  char * label;
+  int minutes;
+  int hours;
+
+  if (!g_settings_get_boolean (p->settings, SETTINGS_SHOW_SUSPEND_DRAIN_S))
+    return G_MENU_MODEL (menu);
+
+  history = indicator_power_suspend_monitor_get_history (p->suspend_monitor, &n);
+  if (n == 0)
+    return G_MENU_MODEL (menu);
+
+  last = &history[n-1];
+  minutes = (int)(last->duration / (60 * G_USEC_PER_SEC));
+  hours = minutes / 60;
+  minutes %= 60;
+
+  /* TRANSLATORS: battery used during the last suspend, how long it slept (H:MM), and the hourly rate.
+     Example: "Last sleep: 2% used in 8:00 (0.3%/h)" */
+  label = g_strdup_printf (_("Last sleep: %.0lf%% used in %0d:%02d (%.1lf%%/h)"),
+                           MAX (last->percentage_before - last->percentage_after, 0.0),
+                           hours,
+                           minutes,
+                           indicator_power_suspend_record_get_drain_rate (last));
+  g_menu_append (menu, label, NULL);
+  g_free (label);
+
+  return G_MENU_MODEL (menu);
+}
+
 /***
 ****
 ****  SETTINGS SECTION
@@ -716,6 +871,173 @@ rebuild_section (GMenu * parent, int pos, GMenuModel * new_section)
   g_object_unref (new_section);
 }
 
+/***
+****  Worker-thread payloads
+****
+****  Building the header and device sections means formatting labels,
+****  loading icons, and serializing variants for every device. On hosts
+****  with many devices that's enough work to delay D-Bus action and menu
+****  calls, so when threaded-payloads is enabled the main context only
+****  takes a snapshot of its inputs, a worker thread builds immutable
+****  payloads from that snapshot, and the main context swaps them in.
+***/
+
+#define PAYLOAD_SECTIONS (SECTION_HEADER | SECTION_DEVICES)
+
+/* everything the worker needs, copied so it shares nothing with the service */
+struct PayloadRequest
+{
+  guint serial;
+  guint sections;
+  GList * devices; /* IndicatorPowerDevice snapshots */
+  IndicatorPowerDevice * primary_device; /* snapshot */
+  gboolean visible;
+  gboolean want_time;
+  gboolean want_percent;
+  gboolean want_power;
+};
+
+struct Payload
+{
+  guint sections;
+  GVariant * header_state;
+  GMenuModel * devices_sections[N_PROFILES];
+};
+
+static void
+payload_request_free (gpointer grequest)
+{
+  struct PayloadRequest * request = grequest;
+
+  g_list_free_full (request->devices, g_object_unref);
+  g_clear_object (&request->primary_device);
+  g_free (request);
+}
+
+static void
+payload_free (gpointer gpayload)
+{
+  struct Payload * payload = gpayload;
+  int i;
+
+  g_clear_pointer (&payload->header_state, g_variant_unref);
+  for (i=0; i<N_PROFILES; ++i)
+    g_clear_object (&payload->devices_sections[i]);
+  g_free (payload);
+}
+
+static void
+prepare_payload_thread (GTask        * task,
+                        gpointer       source_object G_GNUC_UNUSED,
+                        gpointer       task_data,
+                        GCancellable * cancellable   G_GNUC_UNUSED)
+{
+  const struct PayloadRequest * request = task_data;
+  struct Payload * payload = g_new0 (struct Payload, 1);
+
+  payload->sections = request->sections;
+
+  if (request->sections & SECTION_HEADER)
+    {
+      payload->header_state = g_variant_ref_sink (create_header_state_for (request->primary_device,
+                                                                           request->visible,
+                                                                           request->want_time,
+                                                                           request->want_percent,
+                                                                           request->want_power));
+    }
+
+  if (request->sections & SECTION_DEVICES)
+    {
+      payload->devices_sections[PROFILE_DESKTOP] = create_desktop_devices_section_for (request->devices, PROFILE_DESKTOP);
+      payload->devices_sections[PROFILE_DESKTOP_GREETER] = create_desktop_devices_section_for (request->devices, PROFILE_DESKTOP_GREETER);
+    }
+
+  g_task_return_pointer (task, payload, payload_free);
+}
+
+static void
+on_payload_ready (GObject      * source_object,
+                  GAsyncResult * res,
+                  gpointer       user_data     G_GNUC_UNUSED)
+{
+  IndicatorPowerService * self = INDICATOR_POWER_SERVICE (source_object);
+  const struct PayloadRequest * request = g_task_get_task_data (G_TASK (res));
+  struct Payload * payload;
+  GError * error = NULL;
+  priv_t * p;
+  int i;
+
+  payload = g_task_propagate_pointer (G_TASK (res), &error);
+  if (payload == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Unable to prepare menu payload: %s", error->message);
+
+      g_clear_error (&error);
+      return;
+    }
+
+  p = self->priv;
+
+  /* a newer request is in flight and it covers these sections too */
+  if (request->serial != p->payload_serial)
+    {
+      payload_free (payload);
+      return;
+    }
+
+  p->pending_payload_sections = 0;
+
+  if (payload->sections & SECTION_HEADER)
+    g_simple_action_set_state (p->header_action, payload->header_state);
+
+  if (p->menus_built && (payload->sections & SECTION_DEVICES))
+    {
+      for (i=0; i<N_PROFILES; ++i)
+        {
+          if (payload->devices_sections[i] != NULL)
+            {
+              rebuild_section (p->menus[i].submenu, 0, payload->devices_sections[i]);
+              payload->devices_sections[i] = NULL; /* rebuild_section() took it */
+            }
+        }
+    }
+
+  payload_free (payload);
+}
+
+static void
+request_payload (IndicatorPowerService * self, guint sections)
+{
+  priv_t * p = self->priv;
+  struct PayloadRequest * request;
+  GTask * task;
+  GList * l;
+
+  /* fold in sections from any request that's still in flight,
+     since on_payload_ready() will discard that one */
+  p->pending_payload_sections |= sections;
+
+  request = g_new0 (struct PayloadRequest, 1);
+  request->serial = ++p->payload_serial;
+  request->sections = p->pending_payload_sections;
+  request->visible = should_be_visible (self);
+  request->want_time = g_settings_get_boolean (p->settings, SETTINGS_SHOW_TIME_S);
+  request->want_percent = g_settings_get_boolean (p->settings, SETTINGS_SHOW_PERCENTAGE_S);
+  request->want_power = g_settings_get_boolean (p->settings, SETTINGS_SHOW_POWER_IN_MENU_BAR_S);
+  if (p->primary_device != NULL)
+    request->primary_device = indicator_power_device_copy (p->primary_device);
+  for (l=p->devices; l!=NULL; l=l->next)
+    request->devices = g_list_prepend (request->devices, indicator_power_device_copy (l->data));
+  request->devices = g_list_reverse (request->devices);
+
+  task = g_task_new (self, p->cancellable, on_payload_ready, NULL);
+  g_task_set_source_tag (task, request_payload);
+  g_task_set_task_data (task, request, payload_request_free);
+  g_task_run_in_thread (task, prepare_payload_thread);
+  g_object_unref (task);
+}
+
 static void
 rebuild_now (IndicatorPowerService * self, guint sections)
 {
@@ -724,6 +1046,12 @@ rebuild_now (IndicatorPowerService * self, guint sections)
   struct ProfileMenuInfo * desktop = &p->menus[PROFILE_DESKTOP];
   struct ProfileMenuInfo * greeter = &p->menus[PROFILE_DESKTOP_GREETER];
 
+  if (p->threaded_payloads && (sections & PAYLOAD_SECTIONS))
+    {
+      request_payload (self, sections & PAYLOAD_SECTIONS);
+      sections &= ~PAYLOAD_SECTIONS;
+    }
+
   if (sections & SECTION_HEADER)
     {
       g_simple_action_set_state (p->header_action, create_header_state (self));
@@ -738,9 +1066,19 @@ rebuild_now (IndicatorPowerService * self, guint sections)
       rebuild_section (greeter->submenu, 0, create_desktop_devices_section (self, PROFILE_DESKTOP_GREETER));
     }
 
+  if (sections & SECTION_CONSUMERS)
+    {
+      rebuild_section (desktop->submenu, 1, create_desktop_consumers_section (self));
+    }
+
+  if (sections & SECTION_SUSPEND)
+    {
+      rebuild_section (desktop->submenu, 2, create_desktop_suspend_section (self));
+    }
+
   if (sections & SECTION_SETTINGS)
     {
-      rebuild_section (desktop->submenu, 1, create_desktop_settings_section (self));
+      rebuild_section (desktop->submenu, 3, create_desktop_settings_section (self));
       rebuild_section (phone->submenu, 1, create_phone_settings_section (self));
     }
 }
@@ -775,6 +1113,8 @@ create_menu (IndicatorPowerService * self, int profile)
 
       case PROFILE_DESKTOP:
         sections[n++] = create_desktop_devices_section (self, PROFILE_DESKTOP);
+        sections[n++] = create_desktop_consumers_section (self);
+        sections[n++] = create_desktop_suspend_section (self);
         sections[n++] = create_desktop_settings_section (self);
         break;
 
@@ -797,6 +1137,13 @@ create_menu (IndicatorPowerService * self, int profile)
   header = g_menu_item_new (NULL, "indicator._header");
   g_menu_item_set_attribute (header, "x-ayatana-type",
                              "s", "org.ayatana.indicator.root");
+  if (profile == PROFILE_DESKTOP)
+    {
+      /* the renderer sets this to TRUE while the menu is open,
+         so that /proc is only sampled when someone's looking */
+      g_menu_item_set_attribute (header, "submenu-action",
+                                 "s", "indicator.consumers-active");
+    }
   g_menu_item_set_submenu (header, G_MENU_MODEL (submenu));
   g_object_unref (submenu);
 
@@ -882,12 +1229,18 @@ convert_auto_state_to_prop(GBinding     * binding     G_GNUC_UNUSED,
   return TRUE;
 }
 
+static void on_consumers_active_change_requested (GSimpleAction * action,
+                                                  GVariant      * state,
+                                                  gpointer        gself);
+
 static void
 init_gactions (IndicatorPowerService * self)
 {
   GSimpleAction * a;
   GAction * show_time_action;
   GAction * show_percentage_action;
+  GAction * show_power_action;
+  GAction * show_power_in_menu_bar_action;
   priv_t * p = self->priv;
 
   GActionEntry entries[] = {
@@ -941,6 +1294,12 @@ init_gactions (IndicatorPowerService * self)
   g_signal_connect (a, "change-state", G_CALLBACK(on_brightness_change_requested), self);
   p->brightness_action = a;
 
+  /* add the consumers-active action */
+  a = g_simple_action_new_stateful ("consumers-active", NULL, g_variant_new_boolean (FALSE));
+  g_action_map_add_action (G_ACTION_MAP(p->actions), G_ACTION(a));
+  g_signal_connect (a, "change-state", G_CALLBACK(on_consumers_active_change_requested), self);
+  p->consumers_active_action = a;
+
   /* add the show-time action */
   show_time_action = g_settings_create_action (p->settings, "show-time");
   g_action_map_add_action (G_ACTION_MAP(p->actions), show_time_action);
@@ -949,10 +1308,18 @@ init_gactions (IndicatorPowerService * self)
   show_percentage_action = g_settings_create_action (p->settings, "show-percentage");
   g_action_map_add_action (G_ACTION_MAP(p->actions), show_percentage_action);
 
+  /* add the show-power actions */
+  show_power_action = g_settings_create_action (p->settings, "show-power");
+  g_action_map_add_action (G_ACTION_MAP(p->actions), show_power_action);
+  show_power_in_menu_bar_action = g_settings_create_action (p->settings, "show-power-in-menu-bar");
+  g_action_map_add_action (G_ACTION_MAP(p->actions), show_power_in_menu_bar_action);
+
   rebuild_header_now (self);
 
   g_object_unref (show_time_action);
   g_object_unref (show_percentage_action);
+  g_object_unref (show_power_action);
+  g_object_unref (show_power_in_menu_bar_action);
 }
 
 /***
@@ -980,6 +1347,16 @@ on_bus_acquired (GDBusConnection * connection,
   if (p->notifier != NULL)
     indicator_power_notifier_set_bus (p->notifier, connection);
 
+  /* export the diagnostics */
+  if (!indicator_power_dbus_properties_export (p->diagnostics_props,
+                                               connection,
+                                               BUS_PATH"/Diagnostics",
+                                               &err))
+    {
+      g_warning ("cannot export diagnostics: %s", err->message);
+      g_clear_error (&err);
+    }
+
   /* export the actions */
   if ((id = g_dbus_connection_export_action_group (connection,
                                                    BUS_PATH,
@@ -1042,6 +1419,10 @@ unexport (IndicatorPowerService * self)
       g_dbus_connection_unexport_action_group (p->conn, p->actions_export_id);
       p->actions_export_id = 0;
     }
+
+  /* unexport the diagnostics */
+  if (p->diagnostics_props != NULL)
+    indicator_power_dbus_properties_unexport (p->diagnostics_props);
 }
 
 static void
@@ -1058,6 +1439,140 @@ on_name_lost (GDBusConnection * connection G_GNUC_UNUSED,
   g_signal_emit (self, signals[SIGNAL_NAME_LOST], 0, NULL);
 }
 
+/***
+****  Top consumers sampling
+***/
+
+static gboolean
+is_draining_fast (IndicatorPowerService * self)
+{
+  const IndicatorPowerDevice * device = self->priv->primary_device;
+  gdouble percentage;
+  time_t time_left;
+
+  if ((device == NULL) || (indicator_power_device_get_state (device) != UP_DEVICE_STATE_DISCHARGING))
+    return FALSE;
+
+  percentage = indicator_power_device_get_percentage (device);
+  time_left = indicator_power_device_get_time (device);
+  if ((percentage <= 0) || (time_left <= 0))
+    return FALSE;
+
+  return percentage * 3600.0 / time_left >= FAST_DRAIN_PERCENT_PER_HOUR;
+}
+
+static gboolean
+on_sampler_timer (gpointer gself)
+{
+  IndicatorPowerService * self = INDICATOR_POWER_SERVICE (gself);
+
+  indicator_power_process_sampler_sample (self->priv->sampler);
+  rebuild_now (self, SECTION_CONSUMERS);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* starts or stops sampling /proc, depending on whether anyone can see it */
+static void
+update_consumers_sampling (IndicatorPowerService * self)
+{
+  priv_t * p = self->priv;
+  gboolean wanted = FALSE;
+
+  if ((p->settings != NULL) && (g_settings_get_int (p->settings, SETTINGS_TOP_CONSUMERS_S) > 0))
+    {
+      GVariant * state = g_action_get_state (G_ACTION (p->consumers_active_action));
+      wanted = g_variant_get_boolean (state) || is_draining_fast (self);
+      g_variant_unref (state);
+    }
+
+  if (wanted && (p->sampler_timer == 0))
+    {
+      if (p->sampler == NULL)
+        p->sampler = indicator_power_process_sampler_new (NULL);
+
+      if (p->sampler != NULL)
+        {
+          /* take a baseline so the first tick has something to diff against */
+          indicator_power_process_sampler_sample (p->sampler);
+          p->sampler_timer = g_timeout_add_seconds (TOP_CONSUMERS_INTERVAL_SEC, on_sampler_timer, self);
+        }
+    }
+  else if (!wanted && (p->sampler_timer != 0))
+    {
+      g_source_remove (p->sampler_timer);
+      p->sampler_timer = 0;
+
+      /* free it to close its fds; it'll be rebuilt next time */
+      g_clear_pointer (&p->sampler, indicator_power_process_sampler_free);
+      rebuild_now (self, SECTION_CONSUMERS);
+    }
+}
+
+/* The sampler's entries and open stat files are only a baseline for
+   the next tick. Dropping them costs the consumers section one tick */
+static void
+on_memory_pressure_shed (IndicatorPowerService * self)
+{
+  priv_t * p = self->priv;
+
+  if (p->sampler != NULL)
+    indicator_power_process_sampler_shed (p->sampler);
+}
+
+/* menu renderers set this to TRUE while the menu is showing */
+static void
+on_consumers_active_change_requested (GSimpleAction * action,
+                                      GVariant      * state,
+                                      gpointer        gself)
+{
+  g_simple_action_set_state (action, state);
+  update_consumers_sampling (INDICATOR_POWER_SERVICE (gself));
+}
+
+/***
+****  Diagnostics
+***/
+
+/* Publishes how many held-back updates each rate-limited device dropped.
+   A drop always happens while an update is held back, and applying
+   or refreshing that update changes the devices, so this is current
+   as of the last devices-changed. */
+static void
+update_rate_limit_drops (IndicatorPowerService * self)
+{
+  priv_t * p = self->priv;
+  GVariantBuilder b;
+  GList * l;
+
+  g_variant_builder_init (&b, G_VARIANT_TYPE ("a{su}"));
+
+  if (INDICATOR_IS_POWER_DEVICE_PROVIDER_UPOWER (p->device_provider))
+    {
+      IndicatorPowerDeviceProviderUPower * upower = INDICATOR_POWER_DEVICE_PROVIDER_UPOWER (p->device_provider);
+
+      for (l=p->devices; l!=NULL; l=l->next)
+        {
+          const char * path = indicator_power_device_get_object_path (l->data);
+          guint drops;
+
+          if ((path != NULL) && ((drops = indicator_power_device_provider_upower_get_drop_count (upower, path))))
+            g_variant_builder_add (&b, "{su}", path, drops);
+        }
+    }
+
+  indicator_power_dbus_properties_set (p->diagnostics_props, "RateLimitDrops", g_variant_builder_end (&b));
+}
+
+static void
+update_bytes_released (IndicatorPowerService * self)
+{
+  priv_t * p = self->priv;
+  const guint64 bytes = indicator_power_memory_pressure_get_bytes_released (p->memory_pressure);
+
+  indicator_power_dbus_properties_set (p->diagnostics_props, "BytesReleased", g_variant_new_uint64 (bytes));
+}
+
 /***
 ****  Events
 ***/
@@ -1075,11 +1590,17 @@ on_devices_changed (IndicatorPowerService * self)
   g_clear_object (&p->primary_device);
   p->primary_device = indicator_power_service_choose_primary_device (p->devices);
 
-  /* update the notifier's battery */
+  /* update the notifier's and the suspend monitor's battery */
   if ((p->primary_device != NULL) && (indicator_power_device_get_kind(p->primary_device) == UP_DEVICE_KIND_BATTERY))
-    indicator_power_notifier_set_battery (p->notifier, p->primary_device);
+    {
+      indicator_power_notifier_set_battery (p->notifier, p->primary_device);
+      indicator_power_suspend_monitor_set_battery (p->suspend_monitor, p->primary_device);
+    }
   else
-    indicator_power_notifier_set_battery (p->notifier, NULL);
+    {
+      indicator_power_notifier_set_battery (p->notifier, NULL);
+      indicator_power_suspend_monitor_set_battery (p->suspend_monitor, NULL);
+    }
 
   /* update the battery-level action's state */
   g_simple_action_set_state (p->battery_level_action, calculate_battery_level_action_state(self));
@@ -1088,6 +1609,10 @@ on_devices_changed (IndicatorPowerService * self)
   g_simple_action_set_state (p->device_state_action, calculate_device_state_action_state(self));
 
   rebuild_now (self, SECTION_HEADER | SECTION_DEVICES);
+
+  update_consumers_sampling (self);
+
+  update_rate_limit_drops (self);
 }
 
 static void
@@ -1096,6 +1621,46 @@ on_auto_brightness_supported_changed(IndicatorPowerService * self)
   rebuild_now(self, SECTION_SETTINGS);
 }
 
+static void
+push_suspend_history (IndicatorPowerService * self)
+{
+  priv_t * p = self->priv;
+  const IndicatorPowerSuspendRecord * history;
+  GVariantBuilder builder;
+  guint n = 0;
+  guint i;
+
+  if ((p->notifier == NULL) || (p->suspend_monitor == NULL))
+    return;
+
+  history = indicator_power_suspend_monitor_get_history (p->suspend_monitor, &n);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(xxxddd)"));
+  for (i=0; i<n; ++i)
+    g_variant_builder_add (&builder, "(xxxddd)",
+                           history[i].slept_at,
+                           history[i].woke_at,
+                           history[i].duration,
+                           history[i].percentage_before,
+                           history[i].percentage_after,
+                           indicator_power_suspend_record_get_drain_rate (&history[i]));
+
+  indicator_power_notifier_set_suspend_history (p->notifier, g_variant_builder_end (&builder));
+}
+
+static void
+on_suspend_history_changed (IndicatorPowerService * self)
+{
+  push_suspend_history (self);
+  rebuild_now (self, SECTION_SUSPEND);
+}
+
+static inline void
+rebuild_suspend_now (IndicatorPowerService * self)
+{
+  rebuild_now (self, SECTION_SUSPEND);
+}
+
 
 /***
 ****  GObject virtual functions
@@ -1124,6 +1689,10 @@ my_get_property (GObject     * o,
         g_value_set_object (value, p->notifier);
         break;
 
+      case PROP_THREADED_PAYLOADS:
+        g_value_set_boolean (value, p->threaded_payloads);
+        break;
+
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (o, property_id, pspec);
     }
@@ -1147,6 +1716,10 @@ my_set_property (GObject       * o,
         indicator_power_service_set_notifier (self, g_value_get_object (value));
         break;
 
+      case PROP_THREADED_PAYLOADS:
+        self->priv->threaded_payloads = g_value_get_boolean (value);
+        break;
+
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (o, property_id, pspec);
     }
@@ -1165,6 +1738,27 @@ my_dispose (GObject * o)
     }
 
   unexport (self);
+  g_clear_pointer (&p->diagnostics_props, indicator_power_dbus_properties_free);
+
+  if (p->sampler_timer != 0)
+    {
+      g_source_remove (p->sampler_timer);
+      p->sampler_timer = 0;
+    }
+
+  g_clear_pointer (&p->sampler, indicator_power_process_sampler_free);
+
+  if (p->suspend_monitor != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (p->suspend_monitor, self);
+      g_clear_object (&p->suspend_monitor);
+    }
+
+  if (p->memory_pressure != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (p->memory_pressure, self);
+      g_clear_object (&p->memory_pressure);
+    }
 
   if (p->cancellable != NULL)
     {
@@ -1183,6 +1777,7 @@ my_dispose (GObject * o)
   g_clear_object (&p->brightness_action);
   g_clear_object (&p->brightness);
   g_clear_object (&p->battery_level_action);
+  g_clear_object (&p->consumers_active_action);
   g_clear_object (&p->header_action);
   g_clear_object (&p->actions);
 
@@ -1215,9 +1810,28 @@ indicator_power_service_init (IndicatorPowerService * self)
   g_signal_connect_swapped(p->brightness, "notify::percentage",
                            G_CALLBACK(update_brightness_action_state), self);
 
+  p->suspend_monitor = indicator_power_suspend_monitor_new ();
+  g_signal_connect_swapped (p->suspend_monitor, INDICATOR_POWER_SUSPEND_MONITOR_SIGNAL_HISTORY_CHANGED,
+                            G_CALLBACK(on_suspend_history_changed), self);
+
+  p->memory_pressure = indicator_power_memory_pressure_new (NULL);
+  g_signal_connect_swapped (p->memory_pressure, INDICATOR_POWER_MEMORY_PRESSURE_SIGNAL_SHED,
+                            G_CALLBACK(on_memory_pressure_shed), self);
+
+  p->diagnostics_props = indicator_power_dbus_properties_new (INDICATOR_POWER_DIAGNOSTICS_INTROSPECTION_XML, NULL, NULL);
+  indicator_power_dbus_properties_set (p->diagnostics_props, "RateLimitDrops",
+                                       g_variant_new_array (G_VARIANT_TYPE ("{su}"), NULL, 0));
+  update_bytes_released (self);
+  g_signal_connect_swapped (p->memory_pressure, "notify::" INDICATOR_POWER_MEMORY_PRESSURE_PROP_BYTES_RELEASED,
+                            G_CALLBACK(update_bytes_released), self);
+
   init_gactions (self);
 
   g_signal_connect_swapped (p->settings, "changed", G_CALLBACK(rebuild_header_now), self);
+  g_signal_connect_swapped (p->settings, "changed::" SETTINGS_TOP_CONSUMERS_S,
+                            G_CALLBACK(update_consumers_sampling), self);
+  g_signal_connect_swapped (p->settings, "changed::" SETTINGS_SHOW_SUSPEND_DRAIN_S,
+                            G_CALLBACK(rebuild_suspend_now), self);
 
   for (i=0; i<N_PROFILES; ++i)
     create_menu(self, i);
@@ -1277,6 +1891,13 @@ indicator_power_service_class_init (IndicatorPowerServiceClass * klass)
     G_TYPE_OBJECT,
     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_THREADED_PAYLOADS] = g_param_spec_boolean (
+    "threaded-payloads",
+    "Threaded Payloads",
+    "Build header and device menu payloads in a worker thread",
+    FALSE,
+    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (object_class, LAST_PROP, properties);
 }
 
@@ -1348,6 +1969,7 @@ indicator_power_service_set_notifier (IndicatorPowerService  * self,
     {
       p->notifier = g_object_ref (notifier);
       indicator_power_notifier_set_bus (p->notifier, p->conn);
+      push_suspend_history (self);
     }
 }
 
@@ -1359,7 +1981,8 @@ indicator_power_service_set_notifier (IndicatorPowerService  * self,
    the aggregated time remaining should be the maximum of the times
    for all those that are discharging, plus the sum of the times
    for all those that are idle. Otherwise, the aggregated time remaining
-   should be the the maximum of the times for all those that are charging. */
+   should be the the maximum of the times for all those that are charging.
+   The aggregated energy rate is the sum of all of their rates. */
 static IndicatorPowerDevice *
 create_totalled_battery_device (const GList * devices)
 {
@@ -1369,6 +1992,7 @@ create_totalled_battery_device (const GList * devices)
   guint n_discharging = 0;
   guint n_batteries = 0;
   double sum_percent = 0;
+  double sum_energy_rate = 0;
   time_t max_discharge_time = 0;
   time_t max_charge_time = 0;
   time_t sum_charged_time = 0;
@@ -1384,6 +2008,7 @@ create_totalled_battery_device (const GList * devices)
           const time_t t = indicator_power_device_get_time (walk);
           const UpDeviceState state = indicator_power_device_get_state (walk);
 
+          sum_energy_rate += indicator_power_device_get_energy_rate (walk);
 
           if (percent > 0.01)
             {
@@ -1442,6 +2067,8 @@ create_totalled_battery_device (const GList * devices)
                                            state,
                                            time_left,
                                            TRUE);
+
+      g_object_set (device, INDICATOR_POWER_DEVICE_ENERGY_RATE, sum_energy_rate, NULL);
     }
 
   return device;
@@ -1486,10 +2113,72 @@ indicator_power_service_choose_primary_device (GList * devices)
   if (devices != NULL)
     {
       GList * tmp = merge_batteries_together (devices);
-      tmp = g_list_sort (tmp, device_compare_func);
-      primary = g_object_ref (tmp->data);
+      IndicatorPowerDeviceTable * table = indicator_power_device_table_new_from_list (tmp);
+      guint first;
+
+      /* The batch priorities usually settle it. When they don't,
+         the sort decides ties the same way it always has */
+      indicator_power_device_table_compute (table);
+      if (indicator_power_device_table_find_first (table, &first))
+        {
+          primary = g_object_ref (g_list_nth_data (tmp, first));
+        }
+      else
+        {
+          tmp = g_list_sort (tmp, device_compare_func);
+          primary = g_object_ref (tmp->data);
+        }
+
+      indicator_power_device_table_free (table);
       g_list_free_full (tmp, (GDestroyNotify)g_object_unref);
     }
 
   return primary;
 }
+
+/* The rest of these just expose the static helpers above
+   so that tests can check them directly. */
+
+int
+indicator_power_service_compare_devices (const IndicatorPowerDevice * a,
+                                         const IndicatorPowerDevice * b)
+{
+  return device_compare_func (a, b);
+}
+
+IndicatorPowerDevice *
+indicator_power_service_create_totalled_battery_device (const GList * devices)
+{
+  return create_totalled_battery_device (devices);
+}
+
+void
+indicator_power_service_count_batteries (GList * devices,
+                                         int   * total,
+                                         int   * inuse)
+{
+  count_batteries (devices, total, inuse);
+}
+
+GActionGroup *
+indicator_power_service_get_action_group (IndicatorPowerService * self)
+{
+  g_return_val_if_fail (INDICATOR_IS_POWER_SERVICE(self), NULL);
+
+  return G_ACTION_GROUP (self->priv->actions);
+}
+
+GMenuModel *
+indicator_power_service_get_menu_model (IndicatorPowerService * self,
+                                        const char            * profile)
+{
+  int i;
+
+  g_return_val_if_fail (INDICATOR_IS_POWER_SERVICE(self), NULL);
+
+  for (i=0; i<N_PROFILES; ++i)
+    if (!g_strcmp0 (menu_names[i], profile))
+      return G_MENU_MODEL (self->priv->menus[i].menu);
+
+  g_return_val_if_reached (NULL);
+}
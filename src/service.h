@@ -22,6 +22,7 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include <gio/gio.h>
 
 #include "device-provider.h"
 #include "notifier.h"
@@ -76,6 +77,24 @@ void indicator_power_service_set_notifier (IndicatorPowerService  * self,
 
 IndicatorPowerDevice * indicator_power_service_choose_primary_device (GList * devices);
 
+/* exposed for tests */
+
+int indicator_power_service_compare_devices (const IndicatorPowerDevice * a,
+                                             const IndicatorPowerDevice * b);
+
+IndicatorPowerDevice * indicator_power_service_create_totalled_battery_device (const GList * devices);
+
+void indicator_power_service_count_batteries (GList * devices,
+                                              int   * total,
+                                              int   * inuse);
+
+/* the exported actions */
+GActionGroup * indicator_power_service_get_action_group (IndicatorPowerService * self);
+
+/* the exported menu for @profile: "phone", "desktop" or "desktop_greeter" */
+GMenuModel * indicator_power_service_get_menu_model (IndicatorPowerService * self,
+                                                     const char            * profile);
+
 
 
 G_END_DECLS
@@ -0,0 +1,575 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "suspend-monitor.h"
+
+#include <gio/gio.h>
+#include <gio/gunixfdlist.h>
+
+#include <time.h> /* clock_gettime() */
+#include <unistd.h> /* close() */
+
+#define LOGIN1_NAME "org.freedesktop.login1"
+#define LOGIN1_PATH "/org/freedesktop/login1"
+#define LOGIN1_MANAGER_IFACE "org.freedesktop.login1.Manager"
+
+/* sleeps shorter than this are too short to say anything about the drain */
+#define DEFAULT_MIN_SLEEP_SECONDS 300
+
+/* After waking, the battery's first update is the one we want. UPower
+   usually refreshes within a few seconds; if it hasn't by now,
+   use whatever it reports. */
+#define WAKE_SAMPLE_TIMEOUT_SEC 30
+
+enum
+{
+  SIGNAL_HISTORY_CHANGED,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+enum
+{
+  PROP_0,
+  PROP_MIN_SLEEP_SECONDS,
+  LAST_PROP
+};
+
+static GParamSpec * properties[LAST_PROP];
+
+typedef struct
+{
+  GCancellable * cancellable;
+  GDBusConnection * system_bus;
+  guint prepare_for_sleep_tag;
+
+  /* the logind delay inhibitor, or -1 */
+  int inhibitor_fd;
+  gboolean inhibitor_pending;
+
+  guint min_sleep_seconds;
+
+  IndicatorPowerDevice * battery;
+
+  /* TRUE between PrepareForSleep(true) and PrepareForSleep(false) */
+  gboolean sleeping;
+
+  /* the sample taken at PrepareForSleep(true), if the battery was discharging */
+  gboolean have_sleep_sample;
+  gdouble sleep_percentage;
+  gint64 sleep_boottime;
+  gint64 sleep_realtime;
+
+  /* after waking, set while we wait for a fresh battery percentage */
+  gboolean awaiting_wake_sample;
+  gint64 wake_boottime; /* when PrepareForSleep(false) arrived */
+  guint wake_timer;
+
+  GArray * history; /* IndicatorPowerSuspendRecord */
+}
+IndicatorPowerSuspendMonitorPrivate;
+
+typedef IndicatorPowerSuspendMonitorPrivate priv_t;
+
+G_DEFINE_TYPE_WITH_PRIVATE(IndicatorPowerSuspendMonitor,
+                           indicator_power_suspend_monitor,
+                           G_TYPE_OBJECT)
+
+#define get_priv(o) ((priv_t*)indicator_power_suspend_monitor_get_instance_private(o))
+
+/***
+****
+***/
+
+/* A monotonic clock that keeps counting while the system is suspended.
+   CLOCK_MONOTONIC stops during suspend, so it can't measure the sleep */
+static gint64
+get_boottime (void)
+{
+#ifdef CLOCK_BOOTTIME
+  struct timespec ts;
+
+  if (clock_gettime (CLOCK_BOOTTIME, &ts) == 0)
+    return (gint64)ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+#endif
+
+  return g_get_real_time ();
+}
+
+static void
+release_inhibitor (IndicatorPowerSuspendMonitor * self)
+{
+  priv_t * p = get_priv (self);
+
+  if (p->inhibitor_fd != -1)
+    {
+      close (p->inhibitor_fd);
+      p->inhibitor_fd = -1;
+    }
+}
+
+static void
+on_inhibit_ready (GObject      * system_bus,
+                  GAsyncResult * res,
+                  gpointer       gself)
+{
+  GError * error;
+  GUnixFDList * fd_list;
+  GVariant * v;
+
+  error = NULL;
+  fd_list = NULL;
+  v = g_dbus_connection_call_with_unix_fd_list_finish (G_DBUS_CONNECTION(system_bus), &fd_list, res, &error);
+
+  if (v != NULL)
+    {
+      IndicatorPowerSuspendMonitor * self = INDICATOR_POWER_SUSPEND_MONITOR (gself);
+      priv_t * p = get_priv (self);
+      gint32 handle = -1;
+      int fd = -1;
+
+      p->inhibitor_pending = FALSE;
+
+      g_variant_get (v, "(h)", &handle);
+      if (fd_list != NULL)
+        fd = g_unix_fd_list_get (fd_list, handle, &error);
+
+      if (fd == -1)
+        {
+          g_warning ("Unable to get logind inhibitor: %s", error ? error->message : "no fd");
+          g_clear_error (&error);
+        }
+      else if (p->sleeping)
+        {
+          /* too late; don't hold up the suspend that's already underway */
+          close (fd);
+        }
+      else
+        {
+          release_inhibitor (self);
+          p->inhibitor_fd = fd;
+        }
+
+      g_variant_unref (v);
+    }
+  else if (error != NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          get_priv (INDICATOR_POWER_SUSPEND_MONITOR (gself))->inhibitor_pending = FALSE;
+          g_debug ("Unable to inhibit sleep: %s", error->message);
+        }
+
+      g_error_free (error);
+    }
+
+  g_clear_object (&fd_list);
+}
+
+static void
+take_inhibitor (IndicatorPowerSuspendMonitor * self)
+{
+  priv_t * p = get_priv (self);
+
+  if ((p->system_bus == NULL) || (p->inhibitor_fd != -1) || p->inhibitor_pending)
+    return;
+
+  p->inhibitor_pending = TRUE;
+  g_dbus_connection_call_with_unix_fd_list (p->system_bus,
+                                            LOGIN1_NAME,
+                                            LOGIN1_PATH,
+                                            LOGIN1_MANAGER_IFACE,
+                                            "Inhibit",
+                                            g_variant_new ("(ssss)",
+                                                           "sleep",
+                                                           "Ayatana Indicator Power",
+                                                           "Measuring battery drain during sleep",
+                                                           "delay"),
+                                            G_VARIANT_TYPE ("(h)"),
+                                            G_DBUS_CALL_FLAGS_NONE,
+                                            -1, /* default timeout */
+                                            NULL, /* no fds to send */
+                                            p->cancellable,
+                                            on_inhibit_ready,
+                                            self);
+}
+
+/***
+****  Sampling
+***/
+
+static void
+append_record (IndicatorPowerSuspendMonitor      * self,
+               const IndicatorPowerSuspendRecord * record)
+{
+  priv_t * p = get_priv (self);
+
+  g_array_append_vals (p->history, record, 1);
+
+  if (p->history->len > INDICATOR_POWER_SUSPEND_MONITOR_HISTORY_SIZE)
+    g_array_remove_index (p->history, 0);
+
+  g_signal_emit (self, signals[SIGNAL_HISTORY_CHANGED], 0);
+}
+
+static void
+finish_wake_sample (IndicatorPowerSuspendMonitor * self)
+{
+  priv_t * p = get_priv (self);
+  IndicatorPowerSuspendRecord record;
+
+  p->awaiting_wake_sample = FALSE;
+
+  if (p->wake_timer != 0)
+    {
+      g_source_remove (p->wake_timer);
+      p->wake_timer = 0;
+    }
+
+  if (p->battery == NULL)
+    return;
+
+  /* the percentage may have been reported well after the wake,
+     so time the record from this sample, not from the wake */
+  record.slept_at = p->sleep_realtime;
+  record.woke_at = g_get_real_time ();
+  record.duration = get_boottime () - p->sleep_boottime;
+  record.percentage_before = p->sleep_percentage;
+  record.percentage_after = indicator_power_device_get_percentage (p->battery);
+
+  /* ...but whether it was a real sleep depends on the sleep alone */
+  if (p->wake_boottime - p->sleep_boottime < (gint64)p->min_sleep_seconds * G_USEC_PER_SEC)
+    {
+      g_debug ("Not recording a %" G_GINT64_FORMAT " second sleep",
+               (p->wake_boottime - p->sleep_boottime) / G_USEC_PER_SEC);
+      return;
+    }
+
+  g_debug ("Slept for %" G_GINT64_FORMAT " seconds: battery went from %.1f%% to %.1f%%",
+           record.duration / G_USEC_PER_SEC,
+           record.percentage_before,
+           record.percentage_after);
+
+  append_record (self, &record);
+}
+
+static gboolean
+on_wake_timer (gpointer gself)
+{
+  IndicatorPowerSuspendMonitor * self = INDICATOR_POWER_SUSPEND_MONITOR (gself);
+
+  get_priv (self)->wake_timer = 0;
+  finish_wake_sample (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+on_prepare_for_sleep (IndicatorPowerSuspendMonitor * self, gboolean start)
+{
+  priv_t * p = get_priv (self);
+
+  if (start)
+    {
+      /* a wake sample that never finished is stale now */
+      p->awaiting_wake_sample = FALSE;
+      if (p->wake_timer != 0)
+        {
+          g_source_remove (p->wake_timer);
+          p->wake_timer = 0;
+        }
+
+      p->sleeping = TRUE;
+      p->have_sleep_sample = (p->battery != NULL)
+                          && (indicator_power_device_get_state (p->battery) == UP_DEVICE_STATE_DISCHARGING);
+
+      if (p->have_sleep_sample)
+        {
+          p->sleep_percentage = indicator_power_device_get_percentage (p->battery);
+          p->sleep_boottime = get_boottime ();
+          p->sleep_realtime = g_get_real_time ();
+        }
+
+      /* let the suspend proceed */
+      release_inhibitor (self);
+    }
+  else
+    {
+      p->sleeping = FALSE;
+
+      if (p->have_sleep_sample)
+        {
+          p->have_sleep_sample = FALSE;
+          p->awaiting_wake_sample = TRUE;
+          p->wake_boottime = get_boottime ();
+          p->wake_timer = g_timeout_add_seconds (WAKE_SAMPLE_TIMEOUT_SEC, on_wake_timer, self);
+        }
+
+      take_inhibitor (self);
+    }
+}
+
+static void
+on_login1_signal (GDBusConnection * connection    G_GNUC_UNUSED,
+                  const gchar     * sender_name   G_GNUC_UNUSED,
+                  const gchar     * object_path   G_GNUC_UNUSED,
+                  const gchar     * interface_name G_GNUC_UNUSED,
+                  const gchar     * signal_name   G_GNUC_UNUSED,
+                  GVariant        * parameters,
+                  gpointer          gself)
+{
+  gboolean start = FALSE;
+
+  if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(b)")))
+    return;
+
+  g_variant_get (parameters, "(b)", &start);
+  on_prepare_for_sleep (INDICATOR_POWER_SUSPEND_MONITOR (gself), start);
+}
+
+static void
+on_system_bus_ready (GObject      * source_object G_GNUC_UNUSED,
+                     GAsyncResult * res,
+                     gpointer       gself)
+{
+  GError * error;
+  GDBusConnection * system_bus;
+
+  error = NULL;
+  system_bus = g_bus_get_finish (res, &error);
+
+  if (system_bus != NULL)
+    {
+      IndicatorPowerSuspendMonitor * self = INDICATOR_POWER_SUSPEND_MONITOR (gself);
+      priv_t * p = get_priv (self);
+
+      p->system_bus = system_bus;
+      p->prepare_for_sleep_tag = g_dbus_connection_signal_subscribe (system_bus,
+                                                                     LOGIN1_NAME,
+                                                                     LOGIN1_MANAGER_IFACE,
+                                                                     "PrepareForSleep",
+                                                                     LOGIN1_PATH,
+                                                                     NULL,
+                                                                     G_DBUS_SIGNAL_FLAGS_NONE,
+                                                                     on_login1_signal,
+                                                                     self,
+                                                                     NULL);
+      take_inhibitor (self);
+    }
+  else if (error != NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_debug ("Unable to get system bus: %s", error->message);
+
+      g_error_free (error);
+    }
+}
+
+/***
+****  GObject virtual functions
+***/
+
+static void
+my_get_property (GObject     * o,
+                 guint         property_id,
+                 GValue      * value,
+                 GParamSpec  * pspec)
+{
+  priv_t * p = get_priv (INDICATOR_POWER_SUSPEND_MONITOR (o));
+
+  switch (property_id)
+    {
+      case PROP_MIN_SLEEP_SECONDS:
+        g_value_set_uint (value, p->min_sleep_seconds);
+        break;
+
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (o, property_id, pspec);
+    }
+}
+
+static void
+my_set_property (GObject       * o,
+                 guint           property_id,
+                 const GValue  * value,
+                 GParamSpec    * pspec)
+{
+  priv_t * p = get_priv (INDICATOR_POWER_SUSPEND_MONITOR (o));
+
+  switch (property_id)
+    {
+      case PROP_MIN_SLEEP_SECONDS:
+        p->min_sleep_seconds = g_value_get_uint (value);
+        break;
+
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (o, property_id, pspec);
+    }
+}
+
+static void
+my_dispose (GObject * o)
+{
+  IndicatorPowerSuspendMonitor * self = INDICATOR_POWER_SUSPEND_MONITOR (o);
+  priv_t * p = get_priv (self);
+
+  if (p->cancellable != NULL)
+    {
+      g_cancellable_cancel (p->cancellable);
+      g_clear_object (&p->cancellable);
+    }
+
+  if (p->wake_timer != 0)
+    {
+      g_source_remove (p->wake_timer);
+      p->wake_timer = 0;
+    }
+
+  if (p->prepare_for_sleep_tag != 0)
+    {
+      g_dbus_connection_signal_unsubscribe (p->system_bus, p->prepare_for_sleep_tag);
+      p->prepare_for_sleep_tag = 0;
+    }
+
+  release_inhibitor (self);
+  g_clear_object (&p->system_bus);
+  g_clear_object (&p->battery);
+
+  G_OBJECT_CLASS (indicator_power_suspend_monitor_parent_class)->dispose (o);
+}
+
+static void
+my_finalize (GObject * o)
+{
+  priv_t * p = get_priv (INDICATOR_POWER_SUSPEND_MONITOR (o));
+
+  g_array_free (p->history, TRUE);
+
+  G_OBJECT_CLASS (indicator_power_suspend_monitor_parent_class)->finalize (o);
+}
+
+/***
+****  Instantiation
+***/
+
+static void
+indicator_power_suspend_monitor_init (IndicatorPowerSuspendMonitor * self)
+{
+  priv_t * p = get_priv (self);
+
+  p->cancellable = g_cancellable_new ();
+  p->inhibitor_fd = -1;
+  p->min_sleep_seconds = DEFAULT_MIN_SLEEP_SECONDS;
+  p->history = g_array_sized_new (FALSE, FALSE, sizeof (IndicatorPowerSuspendRecord),
+                                  INDICATOR_POWER_SUSPEND_MONITOR_HISTORY_SIZE + 1);
+
+  g_bus_get (G_BUS_TYPE_SYSTEM, p->cancellable, on_system_bus_ready, self);
+}
+
+static void
+indicator_power_suspend_monitor_class_init (IndicatorPowerSuspendMonitorClass * klass)
+{
+  GObjectClass * object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = my_dispose;
+  object_class->finalize = my_finalize;
+  object_class->get_property = my_get_property;
+  object_class->set_property = my_set_property;
+
+  signals[SIGNAL_HISTORY_CHANGED] = g_signal_new (
+    INDICATOR_POWER_SUSPEND_MONITOR_SIGNAL_HISTORY_CHANGED,
+    G_TYPE_FROM_CLASS(klass),
+    G_SIGNAL_RUN_LAST,
+    G_STRUCT_OFFSET (IndicatorPowerSuspendMonitorClass, history_changed),
+    NULL, NULL,
+    g_cclosure_marshal_VOID__VOID,
+    G_TYPE_NONE, 0);
+
+  properties[PROP_0] = NULL;
+
+  properties[PROP_MIN_SLEEP_SECONDS] = g_param_spec_uint (
+    INDICATOR_POWER_SUSPEND_MONITOR_PROP_MIN_SLEEP_SECONDS,
+    "Minimum Sleep Seconds",
+    "Sleeps shorter than this aren't recorded",
+    0, G_MAXUINT, DEFAULT_MIN_SLEEP_SECONDS,
+    G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, LAST_PROP, properties);
+}
+
+/***
+****  Public API
+***/
+
+IndicatorPowerSuspendMonitor *
+indicator_power_suspend_monitor_new (void)
+{
+  GObject * o = g_object_new (INDICATOR_TYPE_POWER_SUSPEND_MONITOR, NULL);
+
+  return INDICATOR_POWER_SUSPEND_MONITOR (o);
+}
+
+void
+indicator_power_suspend_monitor_set_battery (IndicatorPowerSuspendMonitor * self,
+                                             IndicatorPowerDevice         * battery)
+{
+  priv_t * p;
+
+  g_return_if_fail (INDICATOR_IS_POWER_SUSPEND_MONITOR (self));
+  g_return_if_fail ((battery == NULL) || INDICATOR_IS_POWER_DEVICE (battery));
+
+  p = get_priv (self);
+
+  if (battery != NULL)
+    g_object_ref (battery);
+  g_clear_object (&p->battery);
+  p->battery = battery;
+
+  /* The first updates after a wake can be stale values that were queued
+     before the suspend. Wait for the percentage to move; if it never
+     does, the wake timer records the sleep as costing nothing. */
+  if (p->awaiting_wake_sample
+      && (battery != NULL)
+      && (indicator_power_device_get_percentage (battery) != p->sleep_percentage))
+    finish_wake_sample (self);
+}
+
+const IndicatorPowerSuspendRecord *
+indicator_power_suspend_monitor_get_history (IndicatorPowerSuspendMonitor * self,
+                                             guint                        * n_records)
+{
+  priv_t * p;
+
+  g_return_val_if_fail (INDICATOR_IS_POWER_SUSPEND_MONITOR (self), NULL);
+  g_return_val_if_fail (n_records != NULL, NULL);
+
+  p = get_priv (self);
+
+  *n_records = p->history->len;
+  return (const IndicatorPowerSuspendRecord *) p->history->data;
+}
+
+gdouble
+indicator_power_suspend_record_get_drain_rate (const IndicatorPowerSuspendRecord * record)
+{
+  g_return_val_if_fail (record != NULL, 0.0);
+
+  if (record->duration <= 0)
+    return 0.0;
+
+  return (record->percentage_before - record->percentage_after) * 3600.0 * G_USEC_PER_SEC / record->duration;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __INDICATOR_POWER_SUSPEND_MONITOR_H__
+#define __INDICATOR_POWER_SUSPEND_MONITOR_H__
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include "device.h"
+
+G_BEGIN_DECLS
+
+/* standard GObject macros */
+#define INDICATOR_POWER_SUSPEND_MONITOR(o)   (G_TYPE_CHECK_INSTANCE_CAST ((o), INDICATOR_TYPE_POWER_SUSPEND_MONITOR, IndicatorPowerSuspendMonitor))
+#define INDICATOR_TYPE_POWER_SUSPEND_MONITOR (indicator_power_suspend_monitor_get_type())
+#define INDICATOR_IS_POWER_SUSPEND_MONITOR(o) (G_TYPE_CHECK_INSTANCE_TYPE ((o), INDICATOR_TYPE_POWER_SUSPEND_MONITOR))
+
+typedef struct _IndicatorPowerSuspendMonitor      IndicatorPowerSuspendMonitor;
+typedef struct _IndicatorPowerSuspendMonitorClass IndicatorPowerSuspendMonitorClass;
+
+/* signal keys */
+#define INDICATOR_POWER_SUSPEND_MONITOR_SIGNAL_HISTORY_CHANGED "history-changed"
+
+/* property keys */
+#define INDICATOR_POWER_SUSPEND_MONITOR_PROP_MIN_SLEEP_SECONDS "min-sleep-seconds"
+
+/* how many of the most recent sleeps are kept */
+#define INDICATOR_POWER_SUSPEND_MONITOR_HISTORY_SIZE 8
+
+/**
+ * Measures how much charge the battery loses while the system is suspended.
+ *
+ * The battery's percentage and the time are sampled when logind announces
+ * PrepareForSleep(true) and again after waking, once the battery has
+ * reported a fresh percentage. Both timestamps are taken with their
+ * sample. A logind "delay" inhibitor is held while awake so that the
+ * first sample is taken before the system goes down.
+ *
+ * Nothing is polled: between the two transitions the only work done is
+ * keeping a reference to the current battery.
+ */
+struct _IndicatorPowerSuspendMonitor
+{
+  /*< private >*/
+  GObject parent;
+};
+
+struct _IndicatorPowerSuspendMonitorClass
+{
+  GObjectClass parent_class;
+
+  /* signals */
+  void (*history_changed) (IndicatorPowerSuspendMonitor * self);
+};
+
+typedef struct
+{
+  /* when the system went to sleep, in microseconds since the epoch */
+  gint64 slept_at;
+
+  /* when the battery was sampled after waking, in microseconds since the epoch */
+  gint64 woke_at;
+
+  /* the time between the two samples, in microseconds, measured on a
+     clock that keeps counting while suspended. This is the sleep plus
+     however long the battery took to report a fresh percentage */
+  gint64 duration;
+
+  gdouble percentage_before;
+  gdouble percentage_after;
+}
+IndicatorPowerSuspendRecord;
+
+/***
+****
+***/
+
+GType indicator_power_suspend_monitor_get_type (void);
+
+IndicatorPowerSuspendMonitor * indicator_power_suspend_monitor_new (void);
+
+/**
+ * Sets the battery to sample. This is cheap enough to call on every
+ * device change; it only does real work right after a wake.
+ */
+void indicator_power_suspend_monitor_set_battery (IndicatorPowerSuspendMonitor * self,
+                                                  IndicatorPowerDevice         * battery);
+
+/**
+ * Returns: the recorded sleeps, oldest first. The array is owned by
+ * @self and is only valid until the next "history-changed" signal.
+ */
+const IndicatorPowerSuspendRecord * indicator_power_suspend_monitor_get_history (IndicatorPowerSuspendMonitor * self,
+                                                                                 guint                        * n_records);
+
+/**
+ * Returns: the percentage lost per hour of sleep. Negative if it gained charge.
+ */
+gdouble indicator_power_suspend_record_get_drain_rate (const IndicatorPowerSuspendRecord * record);
+
+G_END_DECLS
+
+#endif /* __INDICATOR_POWER_SUSPEND_MONITOR_H__ */
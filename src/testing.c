@@ -17,10 +17,11 @@
  *   Charles Kerr <charles.kerr@canonical.com>
  */
 
+#include "dbus-introspection.h"
+#include "dbus-properties.h"
 #include "dbus-shared.h"
 #include "device-provider-mock.h"
 #include "device-provider-upower.h"
-#include "dbus-testing.h"
 #include "service.h"
 #include "testing.h"
 
@@ -46,7 +47,7 @@ static GParamSpec * properties[LAST_PROP];
 typedef struct
 {
   GDBusConnection * bus;
-  DbusTesting * skeleton;
+  IndicatorPowerDBusProperties * testing_props; /* org.ayatana.indicator.power.Testing */
   IndicatorPowerService * service;
   IndicatorPowerDevice * battery_mock;
   gpointer provider_mock;
@@ -72,7 +73,7 @@ update_device_provider (IndicatorPowerTesting * self)
   priv_t * const p = get_priv(self);
   IndicatorPowerDeviceProvider * device_provider;
 
-  device_provider = dbus_testing_get_mock_battery_enabled(p->skeleton)
+  device_provider = g_variant_get_boolean(indicator_power_dbus_properties_get(p->testing_props, "MockBatteryEnabled"))
                   ? p->provider_mock
                   : p->provider_upower;
   indicator_power_service_set_device_provider(p->service, device_provider);
@@ -82,7 +83,6 @@ static void
 set_bus(IndicatorPowerTesting * self, GDBusConnection * bus)
 {
   priv_t * p;
-  GDBusInterfaceSkeleton * skel;
 
   g_return_if_fail(INDICATOR_IS_POWER_TESTING(self));
   g_return_if_fail((bus == NULL) || G_IS_DBUS_CONNECTION(bus));
@@ -92,12 +92,9 @@ set_bus(IndicatorPowerTesting * self, GDBusConnection * bus)
   if (p->bus == bus)
     return;
 
-  skel = G_DBUS_INTERFACE_SKELETON(p->skeleton);
-
   if (p->bus != NULL)
     {
-      if (skel != NULL)
-        g_dbus_interface_skeleton_unexport (skel);
+      indicator_power_dbus_properties_unexport (p->testing_props);
 
       g_clear_object (&p->bus);
     }
@@ -109,10 +106,10 @@ set_bus(IndicatorPowerTesting * self, GDBusConnection * bus)
       p->bus = g_object_ref (bus);
 
       error = NULL;
-      if (!g_dbus_interface_skeleton_export(skel,
-                                            bus,
-                                            BUS_PATH"/Testing",
-                                            &error))
+      if (!indicator_power_dbus_properties_export(p->testing_props,
+                                                  bus,
+                                                  BUS_PATH"/Testing",
+                                                  &error))
         {
           g_warning ("Unable to export Testing properties: %s", error->message);
           g_error_free (error);
@@ -125,29 +122,27 @@ set_bus(IndicatorPowerTesting * self, GDBusConnection * bus)
 ***/
 
 static void
-on_mock_battery_enabled_changed(DbusTesting           * skeleton  G_GNUC_UNUSED,
-                                GParamSpec            * pspec     G_GNUC_UNUSED,
-                                IndicatorPowerTesting * self)
+on_mock_battery_enabled_changed(IndicatorPowerTesting * self)
 {
   update_device_provider (self);
 }
 
 static void
-on_mock_battery_level_changed(DbusTesting           * skeleton,
-                              GParamSpec            * pspec     G_GNUC_UNUSED,
-                              IndicatorPowerTesting * self)
+on_mock_battery_level_changed(IndicatorPowerTesting * self)
 {
-  g_object_set(get_priv(self)->battery_mock,
-               INDICATOR_POWER_DEVICE_PERCENTAGE, (gdouble)dbus_testing_get_mock_battery_level(skeleton),
+  priv_t * const p = get_priv(self);
+  const guint32 level = g_variant_get_uint32(indicator_power_dbus_properties_get(p->testing_props, "MockBatteryLevel"));
+
+  g_object_set(p->battery_mock,
+               INDICATOR_POWER_DEVICE_PERCENTAGE, (gdouble)level,
                NULL);
 }
 
 static void
-on_mock_battery_state_changed(DbusTesting           * skeleton,
-                              GParamSpec            * pspec    G_GNUC_UNUSED,
-                              IndicatorPowerTesting * self)
+on_mock_battery_state_changed(IndicatorPowerTesting * self)
 {
-  const gchar* state_str = dbus_testing_get_mock_battery_state(skeleton);
+  priv_t * const p = get_priv(self);
+  const gchar* state_str = g_variant_get_string(indicator_power_dbus_properties_get(p->testing_props, "MockBatteryState"), NULL);
   UpDeviceState state;
 
   if (!g_strcmp0(state_str, "charging"))
@@ -164,21 +159,39 @@ on_mock_battery_state_changed(DbusTesting           * skeleton,
       state = UP_DEVICE_STATE_UNKNOWN;
     }
 
-  g_object_set(get_priv(self)->battery_mock,
+  g_object_set(p->battery_mock,
                INDICATOR_POWER_DEVICE_STATE, (gint)state,
                NULL);
 }
 
 static void
-on_mock_battery_minutes_left_changed(DbusTesting           * skeleton,
-                                     GParamSpec            * pspec    G_GNUC_UNUSED,
-                                     IndicatorPowerTesting * self)
+on_mock_battery_minutes_left_changed(IndicatorPowerTesting * self)
 {
-  g_object_set(get_priv(self)->battery_mock,
-               INDICATOR_POWER_DEVICE_TIME, (guint64)dbus_testing_get_mock_battery_minutes_left(skeleton),
+  priv_t * const p = get_priv(self);
+  const guint32 minutes = g_variant_get_uint32(indicator_power_dbus_properties_get(p->testing_props, "MockBatteryMinutesLeft"));
+
+  g_object_set(p->battery_mock,
+               INDICATOR_POWER_DEVICE_TIME, (guint64)minutes,
                NULL);
 }
 
+static void
+on_testing_property_changed(IndicatorPowerDBusProperties * props          G_GNUC_UNUSED,
+                            const char                   * property_name,
+                            gpointer                       gself)
+{
+  IndicatorPowerTesting * const self = INDICATOR_POWER_TESTING(gself);
+
+  if (!g_strcmp0(property_name, "MockBatteryEnabled"))
+    on_mock_battery_enabled_changed(self);
+  else if (!g_strcmp0(property_name, "MockBatteryLevel"))
+    on_mock_battery_level_changed(self);
+  else if (!g_strcmp0(property_name, "MockBatteryState"))
+    on_mock_battery_state_changed(self);
+  else if (!g_strcmp0(property_name, "MockBatteryMinutesLeft"))
+    on_mock_battery_minutes_left_changed(self);
+}
+
 static void
 on_bus_changed(IndicatorPowerService * service,
                GParamSpec            * spec     G_GNUC_UNUSED,
@@ -242,7 +255,7 @@ my_dispose(GObject * o)
   priv_t * const p = get_priv (self);
 
   set_bus(self, NULL);
-  g_clear_object(&p->skeleton);
+  g_clear_pointer(&p->testing_props, indicator_power_dbus_properties_free);
   g_clear_object(&p->provider_upower);
   g_clear_object(&p->provider_mock);
   g_clear_object(&p->battery_mock);
@@ -278,22 +291,15 @@ indicator_power_testing_init (IndicatorPowerTesting * self)
 {
   priv_t * const p = get_priv (self);
 
-  /* DBus Skeleton */
-
-  p->skeleton = dbus_testing_skeleton_new();
-  dbus_testing_set_mock_battery_level(p->skeleton, 50u);
-  dbus_testing_set_mock_battery_state(p->skeleton, "discharging");
-  dbus_testing_set_mock_battery_enabled(p->skeleton, FALSE);
-  dbus_testing_set_mock_battery_minutes_left(p->skeleton, 30);
-
-  g_signal_connect(p->skeleton, "notify::mock-battery-enabled",
-                   G_CALLBACK(on_mock_battery_enabled_changed), self);
-  g_signal_connect(p->skeleton, "notify::mock-battery-level",
-                   G_CALLBACK(on_mock_battery_level_changed), self);
-  g_signal_connect(p->skeleton, "notify::mock-battery-state",
-                   G_CALLBACK(on_mock_battery_state_changed), self);
-  g_signal_connect(p->skeleton, "notify::mock-battery-minutes-left",
-                   G_CALLBACK(on_mock_battery_minutes_left_changed), self);
+  /* DBus Properties */
+
+  p->testing_props = indicator_power_dbus_properties_new(INDICATOR_POWER_TESTING_INTROSPECTION_XML,
+                                                         on_testing_property_changed,
+                                                         self);
+  indicator_power_dbus_properties_set(p->testing_props, "MockBatteryLevel", g_variant_new_uint32(50u));
+  indicator_power_dbus_properties_set(p->testing_props, "MockBatteryState", g_variant_new_string("discharging"));
+  indicator_power_dbus_properties_set(p->testing_props, "MockBatteryEnabled", g_variant_new_boolean(FALSE));
+  indicator_power_dbus_properties_set(p->testing_props, "MockBatteryMinutesLeft", g_variant_new_uint32(30u));
 
   /* Mock Battery */
   
@@ -0,0 +1,352 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "glib-fixture.h"
+
+#include "dbus-introspection.h"
+#include "dbus-properties.h"
+
+#include <gtest/gtest.h>
+
+#include <gio/gio.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+  constexpr char const * OBJECT_PATH {"/org/ayatana/indicator/power/Example"};
+  constexpr char const * INTERFACE {"org.ayatana.indicator.power.Example"};
+
+  constexpr char const * INTROSPECTION_XML {
+    "<node>"
+    "  <interface name='org.ayatana.indicator.power.Example'>"
+    "    <property name='Level' type='s' access='read'/>"
+    "    <property name='Warning' type='b' access='read'/>"
+    "    <property name='Minutes' type='u' access='readwrite'/>"
+    "  </interface>"
+    "</node>"
+  };
+}
+
+/***
+****
+***/
+
+class DBusPropertiesTest: public GlibFixture
+{
+  private:
+
+    typedef GlibFixture super;
+
+  protected:
+
+    GTestDBus * test_bus {};
+    GDBusConnection * service_bus {};
+    GDBusConnection * client_bus {};
+    IndicatorPowerDBusProperties * props {};
+    guint subscription {};
+
+    // each PropertiesChanged's changed properties, in order of arrival
+    std::vector<std::map<std::string,GVariant*>> signals;
+    std::vector<std::string> client_sets;
+
+    static GDBusConnection * connect(GTestDBus * bus)
+    {
+      GError * error {};
+      auto connection = g_dbus_connection_new_for_address_sync(g_test_dbus_get_bus_address(bus),
+                                                               GDBusConnectionFlags(G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                                                    G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION),
+                                                               nullptr,
+                                                               nullptr,
+                                                               &error);
+      g_assert_no_error(error);
+      return connection;
+    }
+
+    void SetUp() override
+    {
+      super::SetUp();
+
+      test_bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+      g_test_dbus_up(test_bus);
+      service_bus = connect(test_bus);
+      client_bus = connect(test_bus);
+
+      props = indicator_power_dbus_properties_new(INTROSPECTION_XML,
+                                                  [](IndicatorPowerDBusProperties*, const char * name, gpointer gself){
+                                                    static_cast<DBusPropertiesTest*>(gself)->client_sets.push_back(name);
+                                                  },
+                                                  this);
+      ASSERT_NE(nullptr, props);
+      indicator_power_dbus_properties_set(props, "Level", g_variant_new_string("ok"));
+      indicator_power_dbus_properties_set(props, "Warning", g_variant_new_boolean(false));
+      indicator_power_dbus_properties_set(props, "Minutes", g_variant_new_uint32(30));
+
+      GError * error {};
+      EXPECT_TRUE(indicator_power_dbus_properties_export(props, service_bus, OBJECT_PATH, &error));
+      g_assert_no_error(error);
+
+      // let the initial values go out before we start listening
+      wait_msec();
+
+      subscription = g_dbus_connection_signal_subscribe(client_bus,
+                                                        nullptr,
+                                                        "org.freedesktop.DBus.Properties",
+                                                        "PropertiesChanged",
+                                                        OBJECT_PATH,
+                                                        INTERFACE,
+                                                        G_DBUS_SIGNAL_FLAGS_NONE,
+                                                        on_properties_changed,
+                                                        this,
+                                                        nullptr);
+    }
+
+    void TearDown() override
+    {
+      g_dbus_connection_signal_unsubscribe(client_bus, subscription);
+      g_clear_pointer(&props, indicator_power_dbus_properties_free);
+      clear_signals();
+      g_clear_object(&client_bus);
+      g_clear_object(&service_bus);
+      g_test_dbus_down(test_bus);
+      g_clear_object(&test_bus);
+
+      super::TearDown();
+    }
+
+    static void on_properties_changed(GDBusConnection*,
+                                      const gchar*,
+                                      const gchar*,
+                                      const gchar*,
+                                      const gchar*,
+                                      GVariant * parameters,
+                                      gpointer   gself)
+    {
+      auto self = static_cast<DBusPropertiesTest*>(gself);
+      std::map<std::string,GVariant*> changed;
+
+      GVariantIter * iter {};
+      const gchar * key {};
+      GVariant * value {};
+      g_variant_get(parameters, "(&sa{sv}as)", nullptr, &iter, nullptr);
+      while (g_variant_iter_next(iter, "{&sv}", &key, &value))
+        changed[key] = value;
+      g_variant_iter_free(iter);
+
+      self->signals.push_back(changed);
+    }
+
+    void clear_signals()
+    {
+      for (auto& changed : signals)
+        for (auto& it : changed)
+          g_variant_unref(it.second);
+      signals.clear();
+    }
+
+    // calls a org.freedesktop.DBus.Properties method from the client side
+    GVariant * call(const char * method, GVariant * parameters, GError ** error)
+    {
+      struct Data {
+        GMainLoop * loop;
+        GVariant * reply;
+        GError * error;
+      } data {loop, nullptr, nullptr};
+
+      g_dbus_connection_call(client_bus,
+                             g_dbus_connection_get_unique_name(service_bus),
+                             OBJECT_PATH,
+                             "org.freedesktop.DBus.Properties",
+                             method,
+                             parameters,
+                             nullptr,
+                             G_DBUS_CALL_FLAGS_NONE,
+                             -1,
+                             nullptr,
+                             [](GObject * bus, GAsyncResult * res, gpointer gdata){
+                               auto data = static_cast<Data*>(gdata);
+                               data->reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(bus), res, &data->error);
+                               g_main_loop_quit(data->loop);
+                             },
+                             &data);
+      g_main_loop_run(loop);
+
+      g_propagate_error(error, data.error);
+      return data.reply;
+    }
+
+    GVariant * get_remote(const char * name, GError ** error=nullptr)
+    {
+      auto reply = call("Get", g_variant_new("(ss)", INTERFACE, name), error);
+      GVariant * value {};
+      if (reply != nullptr)
+        {
+          g_variant_get(reply, "(v)", &value);
+          g_variant_unref(reply);
+        }
+      return value;
+    }
+};
+
+/***
+****
+***/
+
+TEST_F(DBusPropertiesTest, RejectsBadXml)
+{
+  expectLogMessage(G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "*Unable to parse D-Bus interface*");
+  EXPECT_EQ(nullptr, indicator_power_dbus_properties_new("<node><interface", nullptr, nullptr));
+}
+
+TEST_F(DBusPropertiesTest, Get)
+{
+  auto level = get_remote("Level");
+  ASSERT_NE(nullptr, level);
+  EXPECT_STREQ("ok", g_variant_get_string(level, nullptr));
+  g_variant_unref(level);
+
+  auto reply = call("GetAll", g_variant_new("(s)", INTERFACE), nullptr);
+  ASSERT_NE(nullptr, reply);
+  auto all = g_variant_get_child_value(reply, 0);
+  EXPECT_EQ(3u, g_variant_n_children(all));
+  guint32 minutes {};
+  EXPECT_TRUE(g_variant_lookup(all, "Minutes", "u", &minutes));
+  EXPECT_EQ(30u, minutes);
+  g_variant_unref(all);
+  g_variant_unref(reply);
+
+  GError * error {};
+  EXPECT_EQ(nullptr, get_remote("NoSuchProperty", &error));
+  EXPECT_NE(nullptr, error);
+  g_clear_error(&error);
+}
+
+TEST_F(DBusPropertiesTest, OneSignalPerFlush)
+{
+  EXPECT_TRUE(indicator_power_dbus_properties_set(props, "Level", g_variant_new_string("low")));
+  EXPECT_TRUE(indicator_power_dbus_properties_set(props, "Warning", g_variant_new_boolean(true)));
+  EXPECT_TRUE(indicator_power_dbus_properties_set(props, "Level", g_variant_new_string("very_low")));
+  wait_msec();
+
+  ASSERT_EQ(1u, signals.size());
+  ASSERT_EQ(2u, signals[0].size());
+  ASSERT_EQ(1u, signals[0].count("Level"));
+  EXPECT_STREQ("very_low", g_variant_get_string(signals[0]["Level"], nullptr));
+  EXPECT_TRUE(g_variant_get_boolean(signals[0]["Warning"]));
+
+  // the local value is visible at once, without waiting for the flush
+  EXPECT_STREQ("very_low", g_variant_get_string(indicator_power_dbus_properties_get(props, "Level"), nullptr));
+}
+
+TEST_F(DBusPropertiesTest, FlushNow)
+{
+  indicator_power_dbus_properties_set(props, "Warning", g_variant_new_boolean(true));
+  indicator_power_dbus_properties_flush(props);
+  indicator_power_dbus_properties_set(props, "Warning", g_variant_new_boolean(false));
+  wait_msec();
+
+  EXPECT_EQ(2u, signals.size());
+}
+
+TEST_F(DBusPropertiesTest, NoSignalWithoutChange)
+{
+  // same value
+  EXPECT_FALSE(indicator_power_dbus_properties_set(props, "Level", g_variant_new_string("ok")));
+  wait_msec();
+  EXPECT_TRUE(signals.empty());
+
+  // changed, then changed back before the flush
+  EXPECT_TRUE(indicator_power_dbus_properties_set(props, "Warning", g_variant_new_boolean(true)));
+  EXPECT_TRUE(indicator_power_dbus_properties_set(props, "Warning", g_variant_new_boolean(false)));
+  wait_msec();
+  EXPECT_TRUE(signals.empty());
+}
+
+TEST_F(DBusPropertiesTest, RejectsWrongType)
+{
+  expectLogMessage(G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "*'Level' can't be set to a 'u'*");
+  EXPECT_FALSE(indicator_power_dbus_properties_set(props, "Level", g_variant_new_uint32(1)));
+  EXPECT_STREQ("ok", g_variant_get_string(indicator_power_dbus_properties_get(props, "Level"), nullptr));
+}
+
+TEST_F(DBusPropertiesTest, ClientSet)
+{
+  GError * error {};
+
+  // writable
+  auto reply = call("Set", g_variant_new("(ssv)", INTERFACE, "Minutes", g_variant_new_uint32(10)), &error);
+  g_assert_no_error(error);
+  g_clear_pointer(&reply, g_variant_unref);
+  wait_msec();
+
+  EXPECT_EQ(std::vector<std::string>{"Minutes"}, client_sets);
+  EXPECT_EQ(10u, g_variant_get_uint32(indicator_power_dbus_properties_get(props, "Minutes")));
+  ASSERT_EQ(1u, signals.size());
+  ASSERT_EQ(1u, signals[0].count("Minutes"));
+  EXPECT_EQ(10u, g_variant_get_uint32(signals[0]["Minutes"]));
+
+  // read-only
+  reply = call("Set", g_variant_new("(ssv)", INTERFACE, "Level", g_variant_new_string("critical")), &error);
+  EXPECT_EQ(nullptr, reply);
+  EXPECT_NE(nullptr, error);
+  g_clear_error(&error);
+  EXPECT_STREQ("ok", g_variant_get_string(indicator_power_dbus_properties_get(props, "Level"), nullptr));
+  EXPECT_EQ(1u, client_sets.size());
+}
+
+TEST_F(DBusPropertiesTest, Unexport)
+{
+  indicator_power_dbus_properties_set(props, "Warning", g_variant_new_boolean(true));
+  indicator_power_dbus_properties_unexport(props);
+  wait_msec();
+  EXPECT_TRUE(signals.empty());
+
+  GError * error {};
+  EXPECT_EQ(nullptr, get_remote("Level", &error));
+  EXPECT_NE(nullptr, error);
+  g_clear_error(&error);
+
+  // changes made while unexported are announced on the next export
+  EXPECT_TRUE(indicator_power_dbus_properties_export(props, service_bus, OBJECT_PATH, nullptr));
+  wait_msec();
+  ASSERT_EQ(1u, signals.size());
+  ASSERT_EQ(1u, signals[0].count("Warning"));
+  EXPECT_TRUE(g_variant_get_boolean(signals[0]["Warning"]));
+}
+
+/* the service's interfaces are generated from data/, doc comments and all */
+TEST_F(DBusPropertiesTest, ParsesServiceInterfaces)
+{
+  struct {
+    const char * xml;
+    const char * property_name;
+    GVariant * value;
+  } interfaces[] {
+    { INDICATOR_POWER_BATTERY_INTROSPECTION_XML, "PowerLevel", g_variant_new_string("ok") },
+    { INDICATOR_POWER_DIAGNOSTICS_INTROSPECTION_XML, "BytesReleased", g_variant_new_uint64(0) },
+    { INDICATOR_POWER_TESTING_INTROSPECTION_XML, "MockBatteryLevel", g_variant_new_uint32(50u) }
+  };
+
+  for (const auto& it : interfaces)
+    {
+      auto service_props = indicator_power_dbus_properties_new(it.xml, nullptr, nullptr);
+      ASSERT_NE(nullptr, service_props) << it.property_name;
+      EXPECT_TRUE(indicator_power_dbus_properties_set(service_props, it.property_name, it.value));
+      indicator_power_dbus_properties_free(service_props);
+    }
+}
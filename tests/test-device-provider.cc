@@ -0,0 +1,1139 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "glib-fixture.h"
+
+#include "device.h"
+#include "device-provider.h"
+#include "device-provider-mock.h"
+#include "device-provider-upower.h"
+
+#include <gtest/gtest.h>
+
+#include <gio/gio.h>
+
+#ifdef HAVE_MALLINFO2
+ #include <malloc.h> // mallinfo2()
+#endif
+
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <vector>
+
+/***
+****  Conformance tests that every IndicatorPowerDeviceProvider must pass.
+****
+****  Each provider is driven through a small "backend" class that knows how
+****  to add, change, remove and restart devices in that provider's source of
+****  truth: the mock gets its devices directly, the UPower provider talks to
+****  a fake org.freedesktop.UPower service on a private test bus.
+***/
+
+namespace
+{
+  struct DeviceSpec
+  {
+    std::string path;
+    UpDeviceKind kind;
+    UpDeviceState state;
+    double percentage;
+    time_t time;
+    bool power_supply;
+    double energy_rate {}; // not compared: providers only report it on request
+
+    bool operator== (const DeviceSpec& that) const
+    {
+      return path == that.path
+          && kind == that.kind
+          && state == that.state
+          && percentage == that.percentage
+          && time == that.time
+          && power_supply == that.power_supply;
+    }
+  };
+
+  std::ostream& operator<< (std::ostream& o, const DeviceSpec& spec)
+  {
+    return o << spec.path << ' ' << int(spec.kind) << ' ' << int(spec.state)
+             << ' ' << spec.percentage << "% " << spec.time << "s "
+             << (spec.power_supply ? "1" : "0");
+  }
+
+  DeviceSpec make_battery (const char * name, double percentage)
+  {
+    return DeviceSpec { std::string("/org/freedesktop/UPower/devices/battery_") + name,
+                        UP_DEVICE_KIND_BATTERY,
+                        UP_DEVICE_STATE_DISCHARGING,
+                        percentage,
+                        60*60,
+                        true };
+  }
+
+  DeviceSpec make_mouse (const char * name, double percentage)
+  {
+    return DeviceSpec { std::string("/org/freedesktop/UPower/devices/mouse_") + name,
+                        UP_DEVICE_KIND_MOUSE,
+                        UP_DEVICE_STATE_DISCHARGING,
+                        percentage,
+                        2*60*60,
+                        false };
+  }
+}
+
+/***
+****  Mock backend
+***/
+
+class MockBackend
+{
+  public:
+
+    static constexpr char const * NAME {"mock"};
+
+    /* upper bounds for the time between a change and the provider reflecting it */
+    static constexpr int ADD_BUDGET_MSEC {100};
+    static constexpr int CHANGE_BUDGET_MSEC {100};
+
+    explicit MockBackend (GTestDBus * /*bus*/):
+      provider_(indicator_power_device_provider_mock_new())
+    {
+    }
+
+    ~MockBackend()
+    {
+      g_clear_object(&provider_);
+
+      for (auto& it : devices_)
+        g_object_unref(it.second);
+    }
+
+    IndicatorPowerDeviceProvider* provider() { return provider_; }
+
+    void add (const DeviceSpec& spec)
+    {
+      auto device = indicator_power_device_new(spec.path.c_str(),
+                                               spec.kind,
+                                               spec.percentage,
+                                               spec.state,
+                                               spec.time,
+                                               spec.power_supply);
+      devices_[spec.path] = device;
+      indicator_power_device_provider_add_device(mock(), device);
+    }
+
+    void change (const DeviceSpec& spec)
+    {
+      g_object_set(devices_.at(spec.path),
+                   INDICATOR_POWER_DEVICE_KIND, gint(spec.kind),
+                   INDICATOR_POWER_DEVICE_STATE, gint(spec.state),
+                   INDICATOR_POWER_DEVICE_PERCENTAGE, spec.percentage,
+                   INDICATOR_POWER_DEVICE_TIME, guint64(spec.time),
+                   nullptr);
+    }
+
+    void remove (const std::string& path)
+    {
+      auto device = devices_.at(path);
+      devices_.erase(path);
+      indicator_power_device_provider_remove_device(mock(), device);
+      g_object_unref(device);
+    }
+
+    /* the mock has nothing to restart, so model it as every device
+       going away and then coming back, which is what a real backend does */
+    void stop()
+    {
+      for (auto& it : devices_)
+        indicator_power_device_provider_remove_device(mock(), it.second);
+    }
+
+    void start()
+    {
+      for (auto& it : devices_)
+        indicator_power_device_provider_add_device(mock(), it.second);
+    }
+
+  private:
+
+    IndicatorPowerDeviceProviderMock* mock()
+    {
+      return INDICATOR_POWER_DEVICE_PROVIDER_MOCK(provider_);
+    }
+
+    IndicatorPowerDeviceProvider * provider_ {};
+    std::map<std::string,IndicatorPowerDevice*> devices_;
+};
+
+/***
+****  UPower backend: a fake org.freedesktop.UPower on the test bus
+***/
+
+class FakeUPower
+{
+  public:
+
+    static constexpr char const * BUS_NAME    {"org.freedesktop.UPower"};
+    static constexpr char const * MGR_IFACE   {"org.freedesktop.UPower"};
+    static constexpr char const * MGR_PATH    {"/org/freedesktop/UPower"};
+    static constexpr char const * DEVICE_IFACE {"org.freedesktop.UPower.Device"};
+
+    explicit FakeUPower (const char * address):
+      address_(address)
+    {
+      const gchar introspection_xml[] =
+        "<node>"
+        "  <interface name='org.freedesktop.UPower'>"
+        "    <method name='EnumerateDevices'>"
+        "      <arg name='devices' type='ao' direction='out' />"
+        "    </method>"
+        "    <signal name='DeviceAdded'>"
+        "      <arg name='device' type='o' />"
+        "    </signal>"
+        "    <signal name='DeviceRemoved'>"
+        "      <arg name='device' type='o' />"
+        "    </signal>"
+        "  </interface>"
+        "  <interface name='org.freedesktop.UPower.Device'>"
+        "    <property name='Type' type='u' access='read' />"
+        "    <property name='State' type='u' access='read' />"
+        "    <property name='Percentage' type='d' access='read' />"
+        "    <property name='TimeToEmpty' type='x' access='read' />"
+        "    <property name='TimeToFull' type='x' access='read' />"
+        "    <property name='PowerSupply' type='b' access='read' />"
+        "    <property name='EnergyRate' type='d' access='read' />"
+        "  </interface>"
+        "</node>";
+
+      node_info_ = g_dbus_node_info_new_for_xml(introspection_xml, nullptr);
+      g_assert(node_info_ != nullptr);
+    }
+
+    ~FakeUPower()
+    {
+      stop();
+      g_dbus_node_info_unref(node_info_);
+    }
+
+    void start()
+    {
+      g_assert(connection_ == nullptr);
+
+      GError * error {};
+      connection_ = g_dbus_connection_new_for_address_sync(
+        address_.c_str(),
+        GDBusConnectionFlags(G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT|
+                             G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION),
+        nullptr, nullptr, &error);
+      g_assert_no_error(error);
+
+      static const GDBusInterfaceVTable mgr_vtable = { on_mgr_method_call, nullptr, nullptr };
+      mgr_registration_id_ = g_dbus_connection_register_object(connection_,
+                                                                MGR_PATH,
+                                                                g_dbus_node_info_lookup_interface(node_info_, MGR_IFACE),
+                                                                &mgr_vtable,
+                                                                this, nullptr, &error);
+      g_assert_no_error(error);
+
+      for (auto& it : devices_)
+        register_device(it.first);
+
+      // export everything before taking the name so that
+      // the provider's EnumerateDevices call sees it all
+      own_id_ = g_bus_own_name_on_connection(connection_,
+                                             BUS_NAME,
+                                             G_BUS_NAME_OWNER_FLAGS_NONE,
+                                             nullptr, nullptr, nullptr, nullptr);
+    }
+
+    void stop()
+    {
+      if (connection_ == nullptr)
+        return;
+
+      g_bus_unown_name(own_id_);
+      own_id_ = 0;
+
+      for (auto& it : registration_ids_)
+        g_dbus_connection_unregister_object(connection_, it.second);
+      registration_ids_.clear();
+
+      g_dbus_connection_unregister_object(connection_, mgr_registration_id_);
+      mgr_registration_id_ = 0;
+
+      g_dbus_connection_close_sync(connection_, nullptr, nullptr);
+      g_clear_object(&connection_);
+    }
+
+    void add (const DeviceSpec& spec)
+    {
+      devices_[spec.path] = spec;
+
+      if (connection_ != nullptr)
+        {
+          register_device(spec.path);
+          emit_mgr_signal("DeviceAdded", spec.path);
+        }
+    }
+
+    void change (const DeviceSpec& spec)
+    {
+      change(spec, { "Type", "State", "Percentage", "TimeToEmpty", "TimeToFull" });
+    }
+
+    /* announces only the named properties */
+    void change (const DeviceSpec& spec, std::initializer_list<const char*> names)
+    {
+      devices_[spec.path] = spec;
+
+      if (connection_ != nullptr)
+        {
+          GVariantBuilder b;
+          g_variant_builder_init(&b, G_VARIANT_TYPE("a{sv}"));
+          for (const auto name : names)
+            g_variant_builder_add(&b, "{sv}", name, get_device_property(spec, name));
+
+          GError * error {};
+          g_dbus_connection_emit_signal(connection_,
+                                        nullptr,
+                                        spec.path.c_str(),
+                                        "org.freedesktop.DBus.Properties",
+                                        "PropertiesChanged",
+                                        g_variant_new("(sa{sv}as)", DEVICE_IFACE, &b, nullptr),
+                                        &error);
+          g_assert_no_error(error);
+        }
+    }
+
+    void remove (const std::string& path)
+    {
+      devices_.erase(path);
+
+      if (connection_ != nullptr)
+        {
+          g_dbus_connection_unregister_object(connection_, registration_ids_.at(path));
+          registration_ids_.erase(path);
+          emit_mgr_signal("DeviceRemoved", path);
+        }
+    }
+
+  private:
+
+    static GVariant* get_device_property (const DeviceSpec& spec, const char * name)
+    {
+      const bool discharging = spec.state == UP_DEVICE_STATE_DISCHARGING;
+
+      if (!g_strcmp0(name, "Type"))
+        return g_variant_new_uint32(spec.kind);
+      if (!g_strcmp0(name, "State"))
+        return g_variant_new_uint32(spec.state);
+      if (!g_strcmp0(name, "Percentage"))
+        return g_variant_new_double(spec.percentage);
+      if (!g_strcmp0(name, "TimeToEmpty"))
+        return g_variant_new_int64(discharging ? spec.time : 0);
+      if (!g_strcmp0(name, "TimeToFull"))
+        return g_variant_new_int64(discharging ? 0 : spec.time);
+      if (!g_strcmp0(name, "PowerSupply"))
+        return g_variant_new_boolean(spec.power_supply);
+      if (!g_strcmp0(name, "EnergyRate"))
+        return g_variant_new_double(spec.energy_rate);
+
+      return nullptr;
+    }
+
+    static void on_mgr_method_call (GDBusConnection       * /*connection*/,
+                                    const gchar           * /*sender*/,
+                                    const gchar           * /*object_path*/,
+                                    const gchar           * /*interface_name*/,
+                                    const gchar           * method_name,
+                                    GVariant              * /*parameters*/,
+                                    GDBusMethodInvocation * invocation,
+                                    gpointer                gself)
+    {
+      auto self = static_cast<FakeUPower*>(gself);
+      g_assert(!g_strcmp0(method_name, "EnumerateDevices"));
+
+      GVariantBuilder b;
+      g_variant_builder_init(&b, G_VARIANT_TYPE("ao"));
+      for (const auto& it : self->devices_)
+        g_variant_builder_add(&b, "o", it.first.c_str());
+      g_dbus_method_invocation_return_value(invocation, g_variant_new("(ao)", &b));
+    }
+
+    static GVariant* on_device_get_property (GDBusConnection * /*connection*/,
+                                             const gchar     * /*sender*/,
+                                             const gchar     * object_path,
+                                             const gchar     * /*interface_name*/,
+                                             const gchar     * property_name,
+                                             GError         ** /*error*/,
+                                             gpointer          gself)
+    {
+      auto self = static_cast<FakeUPower*>(gself);
+      return get_device_property(self->devices_.at(object_path), property_name);
+    }
+
+    void register_device (const std::string& path)
+    {
+      static const GDBusInterfaceVTable device_vtable = { nullptr, on_device_get_property, nullptr };
+
+      GError * error {};
+      registration_ids_[path] = g_dbus_connection_register_object(connection_,
+                                                                  path.c_str(),
+                                                                  g_dbus_node_info_lookup_interface(node_info_, DEVICE_IFACE),
+                                                                  &device_vtable,
+                                                                  this, nullptr, &error);
+      g_assert_no_error(error);
+    }
+
+    void emit_mgr_signal (const char * signal_name, const std::string& path)
+    {
+      GError * error {};
+      g_dbus_connection_emit_signal(connection_,
+                                    nullptr,
+                                    MGR_PATH,
+                                    MGR_IFACE,
+                                    signal_name,
+                                    g_variant_new("(o)", path.c_str()),
+                                    &error);
+      g_assert_no_error(error);
+    }
+
+    const std::string address_;
+    GDBusNodeInfo * node_info_ {};
+    GDBusConnection * connection_ {};
+    guint own_id_ {};
+    guint mgr_registration_id_ {};
+    std::map<std::string,guint> registration_ids_;
+    std::map<std::string,DeviceSpec> devices_;
+};
+
+class UPowerBackend
+{
+  public:
+
+    static constexpr char const * NAME {"upower"};
+
+    /* new devices are folded together by a 500 msec timer before GetAll() */
+    static constexpr int ADD_BUDGET_MSEC {1500};
+    static constexpr int CHANGE_BUDGET_MSEC {250};
+
+    explicit UPowerBackend (GTestDBus * bus):
+      fake_(g_test_dbus_get_bus_address(bus))
+    {
+      fake_.start();
+      provider_ = indicator_power_device_provider_upower_new();
+    }
+
+    ~UPowerBackend()
+    {
+      g_clear_object(&provider_);
+      fake_.stop();
+    }
+
+    IndicatorPowerDeviceProvider* provider() { return provider_; }
+
+    void add (const DeviceSpec& spec) { fake_.add(spec); }
+    void change (const DeviceSpec& spec) { fake_.change(spec); }
+    void change_energy_rate (const DeviceSpec& spec) { fake_.change(spec, {"EnergyRate"}); }
+    void change (const DeviceSpec& spec, std::initializer_list<const char*> names) { fake_.change(spec, names); }
+    void remove (const std::string& path) { fake_.remove(path); }
+    void stop() { fake_.stop(); }
+    void start() { fake_.start(); }
+
+  private:
+
+    FakeUPower fake_;
+    IndicatorPowerDeviceProvider * provider_ {};
+};
+
+/***
+****  The fixture
+***/
+
+template<typename Backend>
+class DeviceProviderFixture: public GlibFixture
+{
+  private:
+
+    typedef GlibFixture super;
+
+    static gboolean wake_loop (gpointer /*unused*/)
+    {
+      return G_SOURCE_CONTINUE;
+    }
+
+  protected:
+
+    static constexpr int DEFAULT_TIMEOUT_MSEC {3000};
+
+    GTestDBus * test_bus {};
+    Backend * backend {};
+    int changed_count {};
+    gulong changed_tag {};
+
+    void SetUp() override
+    {
+      super::SetUp();
+
+      // the UPower provider watches the system bus,
+      // so point it and the session bus at our test bus
+      test_bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+      g_test_dbus_up(test_bus);
+      g_setenv("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address(test_bus), TRUE);
+
+      backend = new Backend(test_bus);
+      changed_tag = g_signal_connect(backend->provider(), "devices-changed",
+                                     G_CALLBACK(+[](IndicatorPowerDeviceProvider*, gpointer gself){
+                                       static_cast<DeviceProviderFixture*>(gself)->changed_count++;
+                                     }), this);
+
+      // let the provider finish connecting
+      wait_msec(100);
+      changed_count = 0;
+    }
+
+    void TearDown() override
+    {
+      g_signal_handler_disconnect(backend->provider(), changed_tag);
+      delete backend;
+      backend = nullptr;
+
+      // let the scaffolding shut down before tearing down the bus
+      wait_msec(100);
+      g_test_dbus_down(test_bus);
+      g_clear_object(&test_bus);
+      g_unsetenv("DBUS_SYSTEM_BUS_ADDRESS");
+
+      super::TearDown();
+    }
+
+    std::map<std::string,DeviceSpec> get_devices()
+    {
+      std::map<std::string,DeviceSpec> ret;
+
+      auto devices = indicator_power_device_provider_get_devices(backend->provider());
+      for (auto l=devices; l!=nullptr; l=l->next)
+        {
+          auto device = INDICATOR_POWER_DEVICE(l->data);
+          const DeviceSpec spec {
+            indicator_power_device_get_object_path(device),
+            indicator_power_device_get_kind(device),
+            indicator_power_device_get_state(device),
+            indicator_power_device_get_percentage(device),
+            indicator_power_device_get_time(device),
+            bool(indicator_power_device_get_power_supply(device))
+          };
+          ret[spec.path] = spec;
+        }
+      g_list_free_full(devices, g_object_unref);
+
+      return ret;
+    }
+
+    bool has_devices (const std::vector<DeviceSpec>& expected)
+    {
+      std::map<std::string,DeviceSpec> tmp;
+      for (const auto& spec : expected)
+        tmp[spec.path] = spec;
+      return tmp == get_devices();
+    }
+
+    /* Iterate the main loop until test() passes or the timeout is reached.
+       Unlike GlibFixture::wait_for(), this wakes up every few msec so that
+       the elapsed time is precise enough to use as a latency measurement. */
+    bool wait_until (std::function<bool()> test, int timeout_msec, int * elapsed_msec=nullptr)
+    {
+      const auto start = g_get_monotonic_time();
+      const auto wake_tag = g_timeout_add(5, wake_loop, nullptr);
+      bool passed;
+
+      for (;;)
+        {
+          passed = test();
+          if (passed || ((g_get_monotonic_time() - start) >= timeout_msec*G_TIME_SPAN_MILLISECOND))
+            break;
+          g_main_context_iteration(nullptr, TRUE);
+        }
+
+      g_source_remove(wake_tag);
+
+      if (elapsed_msec != nullptr)
+        *elapsed_msec = int((g_get_monotonic_time() - start) / G_TIME_SPAN_MILLISECOND);
+
+      return passed;
+    }
+
+    void EXPECT_DEVICES_EVENTUALLY (const std::vector<DeviceSpec>& expected,
+                                    int timeout_msec=DEFAULT_TIMEOUT_MSEC)
+    {
+      EXPECT_TRUE(wait_until([this,&expected](){return has_devices(expected);}, timeout_msec))
+        << "provider: " << Backend::NAME;
+
+      if (!has_devices(expected))
+        for (const auto& it : get_devices())
+          ADD_FAILURE() << "got " << it.second;
+    }
+
+#ifdef HAVE_MALLINFO2
+    static size_t heap_in_use()
+    {
+      return mallinfo2().uordblks;
+    }
+#endif
+};
+
+using Backends = ::testing::Types<MockBackend, UPowerBackend>;
+TYPED_TEST_SUITE(DeviceProviderFixture, Backends);
+
+/***
+****
+***/
+
+TYPED_TEST(DeviceProviderFixture, StartsEmpty)
+{
+  EXPECT_TRUE(this->get_devices().empty());
+}
+
+TYPED_TEST(DeviceProviderFixture, Add)
+{
+  const auto battery = make_battery("BAT0", 52.0);
+  const auto mouse = make_mouse("0", 80.0);
+
+  this->backend->add(battery);
+  this->EXPECT_DEVICES_EVENTUALLY({battery});
+  EXPECT_LT(0, this->changed_count);
+
+  this->changed_count = 0;
+  this->backend->add(mouse);
+  this->EXPECT_DEVICES_EVENTUALLY({battery, mouse});
+  EXPECT_LT(0, this->changed_count);
+}
+
+TYPED_TEST(DeviceProviderFixture, Remove)
+{
+  const auto battery = make_battery("BAT0", 52.0);
+  const auto mouse = make_mouse("0", 80.0);
+
+  this->backend->add(battery);
+  this->backend->add(mouse);
+  this->EXPECT_DEVICES_EVENTUALLY({battery, mouse});
+
+  this->changed_count = 0;
+  this->backend->remove(battery.path);
+  this->EXPECT_DEVICES_EVENTUALLY({mouse});
+  EXPECT_LT(0, this->changed_count);
+
+  this->backend->remove(mouse.path);
+  this->EXPECT_DEVICES_EVENTUALLY({});
+}
+
+TYPED_TEST(DeviceProviderFixture, Change)
+{
+  auto battery = make_battery("BAT0", 52.0);
+
+  this->backend->add(battery);
+  this->EXPECT_DEVICES_EVENTUALLY({battery});
+
+  this->changed_count = 0;
+  battery.state = UP_DEVICE_STATE_CHARGING;
+  battery.percentage = 53.0;
+  battery.time = 30*60;
+  this->backend->change(battery);
+  this->EXPECT_DEVICES_EVENTUALLY({battery});
+  EXPECT_LT(0, this->changed_count);
+}
+
+/* a burst of changes must settle on the last value */
+TYPED_TEST(DeviceProviderFixture, Burst)
+{
+  auto battery = make_battery("BAT0", 100.0);
+
+  this->backend->add(battery);
+  this->EXPECT_DEVICES_EVENTUALLY({battery});
+
+  this->changed_count = 0;
+  constexpr int n_changes {100};
+  for (int i=0; i<n_changes; ++i)
+    {
+      battery.percentage = 100.0 - i*0.5;
+      battery.time = 60*60 - i*10;
+      this->backend->change(battery);
+    }
+  this->EXPECT_DEVICES_EVENTUALLY({battery});
+  EXPECT_LT(0, this->changed_count);
+  this->RecordProperty("burst_devices_changed", this->changed_count);
+}
+
+/* devices go away when the backend does, and come back with it */
+TYPED_TEST(DeviceProviderFixture, Restart)
+{
+  const auto battery = make_battery("BAT0", 52.0);
+  const auto mouse = make_mouse("0", 80.0);
+
+  this->backend->add(battery);
+  this->backend->add(mouse);
+  this->EXPECT_DEVICES_EVENTUALLY({battery, mouse});
+
+  this->backend->stop();
+  this->EXPECT_DEVICES_EVENTUALLY({});
+
+  this->backend->start();
+  this->EXPECT_DEVICES_EVENTUALLY({battery, mouse});
+}
+
+/* interleaved adds, changes, and removes end in the same state everywhere */
+TYPED_TEST(DeviceProviderFixture, Ordering)
+{
+  auto bat0 = make_battery("BAT0", 10.0);
+  auto bat1 = make_battery("BAT1", 20.0);
+  const auto mouse = make_mouse("0", 30.0);
+
+  this->backend->add(bat0);
+  this->backend->add(bat1);
+  this->backend->add(mouse);
+  this->EXPECT_DEVICES_EVENTUALLY({bat0, bat1, mouse});
+
+  bat0.percentage = 11.0;
+  this->backend->change(bat0);
+  bat0.percentage = 12.0;
+  this->backend->change(bat0);
+  this->backend->remove(bat1.path);
+  bat0.state = UP_DEVICE_STATE_CHARGING;
+  bat0.time = 15*60;
+  this->backend->change(bat0);
+  this->EXPECT_DEVICES_EVENTUALLY({bat0, mouse});
+
+  // re-adding a removed path yields the new device, not the old one
+  bat1.kind = UP_DEVICE_KIND_UPS;
+  bat1.percentage = 99.0;
+  this->backend->add(bat1);
+  this->EXPECT_DEVICES_EVENTUALLY({bat0, bat1, mouse});
+}
+
+/***
+****  Performance
+***/
+
+TYPED_TEST(DeviceProviderFixture, Latency)
+{
+  auto battery = make_battery("BAT0", 90.0);
+  int add_msec {};
+  int change_msec {};
+
+  this->backend->add(battery);
+  EXPECT_TRUE(this->wait_until([this,&battery](){return this->has_devices({battery});},
+                               this->DEFAULT_TIMEOUT_MSEC, &add_msec));
+
+  int total_msec {};
+  constexpr int n_changes {20};
+  for (int i=0; i<n_changes; ++i)
+    {
+      battery.percentage -= 1.0;
+      this->backend->change(battery);
+      EXPECT_TRUE(this->wait_until([this,&battery](){return this->has_devices({battery});},
+                                   this->DEFAULT_TIMEOUT_MSEC, &change_msec));
+      total_msec += change_msec;
+    }
+  change_msec = total_msec / n_changes;
+
+  this->RecordProperty("add_latency_msec", add_msec);
+  this->RecordProperty("change_latency_msec", change_msec);
+  g_message("%s: added in %d msec (budget %d), changed in %d msec (budget %d)",
+            TypeParam::NAME, add_msec, TypeParam::ADD_BUDGET_MSEC,
+            change_msec, TypeParam::CHANGE_BUDGET_MSEC);
+
+  // wall-clock budgets are only enforced on hosts meant for benchmarking
+  if (g_getenv("INDICATOR_POWER_TEST_BENCHMARK") != nullptr)
+    {
+      EXPECT_LE(add_msec, TypeParam::ADD_BUDGET_MSEC) << "provider: " << TypeParam::NAME;
+      EXPECT_LE(change_msec, TypeParam::CHANGE_BUDGET_MSEC) << "provider: " << TypeParam::NAME;
+    }
+}
+
+/* steady-state updates must not grow the heap */
+TYPED_TEST(DeviceProviderFixture, HeapGrowth)
+{
+#ifndef HAVE_MALLINFO2
+  GTEST_SKIP() << "mallinfo2() is not available";
+#else
+  auto battery = make_battery("BAT0", 90.0);
+
+  this->backend->add(battery);
+  this->EXPECT_DEVICES_EVENTUALLY({battery});
+
+  auto run_changes = [this,&battery](int n){
+    for (int i=0; i<n; ++i)
+      {
+        battery.percentage = (battery.percentage > 50.0) ? 10.0 : 90.0;
+        this->backend->change(battery);
+        EXPECT_TRUE(this->wait_until([this,&battery](){return this->has_devices({battery});},
+                                     this->DEFAULT_TIMEOUT_MSEC));
+      }
+  };
+
+  // warm up any lazily-created caches before measuring
+  run_changes(20);
+
+  constexpr int n_changes {200};
+  const auto before = this->heap_in_use();
+  run_changes(n_changes);
+  const auto after = this->heap_in_use();
+
+  const auto bytes_per_change = (after > before) ? (after - before) / n_changes : 0;
+  this->RecordProperty("heap_growth_bytes_per_change", int(bytes_per_change));
+  EXPECT_LT(bytes_per_change, 64u) << "provider: " << TypeParam::NAME;
+#endif
+}
+
+/***
+****  UPower rate limiting
+***/
+
+class UPowerRateLimitTest: public DeviceProviderFixture<UPowerBackend>
+{
+  private:
+
+    typedef DeviceProviderFixture<UPowerBackend> super;
+
+  protected:
+
+    GSettings * settings {};
+
+    void SetUp() override
+    {
+      super::SetUp();
+
+      settings = g_settings_new("org.ayatana.indicator.power");
+    }
+
+    void TearDown() override
+    {
+      g_settings_reset(settings, "device-rate-limits");
+      g_settings_reset(settings, "show-power");
+      wait_msec(50);
+      g_clear_object(&settings);
+
+      super::TearDown();
+    }
+
+    void set_rate_limits (const char * rules)
+    {
+      g_settings_set_value(settings, "device-rate-limits", g_variant_new_parsed(rules));
+      wait_msec(50); // let the provider see the change
+    }
+
+    guint drop_count (const std::string& path)
+    {
+      return indicator_power_device_provider_upower_get_drop_count(
+               INDICATOR_POWER_DEVICE_PROVIDER_UPOWER(backend->provider()), path.c_str());
+    }
+};
+
+/* a chatty device's updates are coalesced, but the last one still lands */
+TEST_F(UPowerRateLimitTest, Coalesces)
+{
+  set_rate_limits("[('mouse', 2.0, 1.0)]");
+
+  auto mouse = make_mouse("0", 90.0);
+  backend->add(mouse);
+  EXPECT_DEVICES_EVENTUALLY({mouse});
+
+  changed_count = 0;
+  constexpr int n_changes {20};
+  for (int i=0; i<n_changes; ++i)
+    {
+      mouse.percentage = 90.0 - i;
+      backend->change(mouse);
+    }
+  EXPECT_DEVICES_EVENTUALLY({mouse});
+
+  EXPECT_LT(changed_count, n_changes/2);
+  EXPECT_LT(0u, drop_count(mouse.path));
+  RecordProperty("devices_changed", changed_count);
+  RecordProperty("dropped", int(drop_count(mouse.path)));
+}
+
+/* devices that don't match a rule aren't held back */
+TEST_F(UPowerRateLimitTest, OnlyMatchingDevices)
+{
+  set_rate_limits("[('/org/freedesktop/UPower/devices/mouse_*', 0.5, 1.0)]");
+
+  auto battery = make_battery("BAT0", 90.0);
+  auto mouse = make_mouse("0", 90.0);
+  backend->add(battery);
+  backend->add(mouse);
+  EXPECT_DEVICES_EVENTUALLY({battery, mouse});
+
+  for (int i=0; i<5; ++i)
+    {
+      battery.percentage -= 1.0;
+      backend->change(battery);
+      EXPECT_DEVICES_EVENTUALLY({battery, mouse}, 250);
+    }
+  EXPECT_EQ(0u, drop_count(battery.path));
+}
+
+/* each superseded property counts as a drop */
+TEST_F(UPowerRateLimitTest, DropsPerProperty)
+{
+  set_rate_limits("[('mouse', 0.5, 1.0)]");
+
+  auto mouse = make_mouse("0", 90.0);
+  backend->add(mouse);
+  EXPECT_DEVICES_EVENTUALLY({mouse});
+
+  // spend the only token, then hold back two updates of one property
+  mouse.percentage = 89.0;
+  backend->change(mouse);
+  EXPECT_DEVICES_EVENTUALLY({mouse}, 250);
+  mouse.percentage = 88.0;
+  backend->change(mouse, {"Percentage"});
+  mouse.percentage = 87.0;
+  backend->change(mouse, {"Percentage"});
+  wait_msec(100);
+  EXPECT_EQ(1u, drop_count(mouse.path));
+
+  // a whole-device update supersedes only the held-back Percentage
+  mouse.percentage = 86.0;
+  backend->change(mouse);
+  wait_msec(100);
+  EXPECT_EQ(2u, drop_count(mouse.path));
+
+  EXPECT_DEVICES_EVENTUALLY({mouse});
+}
+
+/* a refresh supersedes anything that's still held back */
+TEST_F(UPowerRateLimitTest, RefreshClearsHeldBack)
+{
+  set_rate_limits("[('mouse', 0.5, 1.0)]");
+
+  auto mouse = make_mouse("0", 90.0);
+  backend->add(mouse);
+  EXPECT_DEVICES_EVENTUALLY({mouse});
+
+  // spend the only token, then hold back an update
+  mouse.percentage = 89.0;
+  backend->change(mouse);
+  EXPECT_DEVICES_EVENTUALLY({mouse}, 250);
+  mouse.percentage = 88.0;
+  backend->change(mouse, {"Percentage"});
+
+  // the device moves on without saying so, and a refresh picks it up
+  mouse.percentage = 87.0;
+  backend->change(mouse, {});
+  g_settings_set_boolean(settings, "show-power", true);
+  EXPECT_DEVICES_EVENTUALLY({mouse}, 1500);
+  EXPECT_EQ(1u, drop_count(mouse.path));
+
+  // the held-back update doesn't land on top of the refresh
+  wait_msec(2500);
+  EXPECT_DEVICES_EVENTUALLY({mouse}, 0);
+}
+
+/* state changes and low levels skip the queue */
+TEST_F(UPowerRateLimitTest, Bypass)
+{
+  set_rate_limits("[('mouse', 0.2, 1.0)]");
+
+  auto mouse = make_mouse("0", 90.0);
+  backend->add(mouse);
+  EXPECT_DEVICES_EVENTUALLY({mouse});
+
+  // spend the only token, then queue one up behind it
+  mouse.percentage = 89.0;
+  backend->change(mouse);
+  EXPECT_DEVICES_EVENTUALLY({mouse}, 250);
+  mouse.percentage = 88.0;
+  backend->change(mouse);
+
+  // the next token is 5 seconds away, but a state change shows at once
+  mouse.state = UP_DEVICE_STATE_CHARGING;
+  backend->change(mouse);
+  EXPECT_DEVICES_EVENTUALLY({mouse}, 250);
+
+  // so does a low level
+  mouse.percentage = 4.0;
+  backend->change(mouse);
+  EXPECT_DEVICES_EVENTUALLY({mouse}, 250);
+}
+
+/***
+****  UPower EnergyRate smoothing
+***/
+
+class UPowerEnergyRateTest: public DeviceProviderFixture<UPowerBackend>
+{
+  private:
+
+    typedef DeviceProviderFixture<UPowerBackend> super;
+
+  protected:
+
+    GSettings * settings {};
+
+    void SetUp() override
+    {
+      super::SetUp();
+
+      settings = g_settings_new("org.ayatana.indicator.power");
+    }
+
+    void TearDown() override
+    {
+      g_settings_reset(settings, "show-power");
+      wait_msec(50);
+      g_clear_object(&settings);
+
+      super::TearDown();
+    }
+
+    void set_show_power (bool show)
+    {
+      g_settings_set_boolean(settings, "show-power", show);
+      wait_msec(50); // let the provider see the change
+    }
+
+    double energy_rate (const std::string& path)
+    {
+      double rate {-1.0};
+
+      auto devices = indicator_power_device_provider_get_devices(backend->provider());
+      for (auto l=devices; l!=nullptr; l=l->next)
+        if (path == indicator_power_device_get_object_path(INDICATOR_POWER_DEVICE(l->data)))
+          rate = indicator_power_device_get_energy_rate(INDICATOR_POWER_DEVICE(l->data));
+      g_list_free_full(devices, g_object_unref);
+
+      return rate;
+    }
+
+    void EXPECT_ENERGY_RATE_EVENTUALLY (double expected, const std::string& path)
+    {
+      EXPECT_TRUE(wait_until([this,expected,&path](){return G_APPROX_VALUE(expected, energy_rate(path), 1e-9);},
+                             DEFAULT_TIMEOUT_MSEC))
+        << "expected " << expected << " got " << energy_rate(path);
+    }
+
+    /* adds a battery whose first EnergyRate sample, from GetAll(), is @rate */
+    DeviceSpec add_battery (double rate)
+    {
+      auto battery = make_battery("BAT0", 80.0);
+      battery.energy_rate = rate;
+      backend->add(battery);
+      EXPECT_DEVICES_EVENTUALLY({battery});
+      EXPECT_ENERGY_RATE_EVENTUALLY(rate, battery.path);
+      return battery;
+    }
+};
+
+/* each sample moves the average 30% of the way towards it */
+TEST_F(UPowerEnergyRateTest, MovingAverage)
+{
+  set_show_power(true);
+  auto battery = add_battery(10.0);
+
+  battery.energy_rate = 20.0;
+  backend->change_energy_rate(battery);
+  EXPECT_ENERGY_RATE_EVENTUALLY(13.0, battery.path); // 10 + 0.3 * (20 - 10)
+
+  backend->change_energy_rate(battery);
+  EXPECT_ENERGY_RATE_EVENTUALLY(15.1, battery.path); // 13 + 0.3 * (20 - 13)
+}
+
+/* jitter smaller than the 0.1 W display step doesn't reach the device */
+TEST_F(UPowerEnergyRateTest, Quantized)
+{
+  set_show_power(true);
+  auto battery = add_battery(10.0);
+
+  changed_count = 0;
+  battery.energy_rate = 10.2;
+  backend->change_energy_rate(battery); // average 10.06
+  wait_msec(200);
+  EXPECT_EQ(0, changed_count);
+  EXPECT_DOUBLE_EQ(10.0, energy_rate(battery.path));
+
+  backend->change_energy_rate(battery); // average 10.102, shown rounded
+  EXPECT_ENERGY_RATE_EVENTUALLY(10.1, battery.path);
+  EXPECT_LT(0, changed_count);
+}
+
+/* charging and discharging rates aren't averaged together */
+TEST_F(UPowerEnergyRateTest, ResetOnStateChange)
+{
+  set_show_power(true);
+  auto battery = add_battery(10.0);
+
+  // a change that keeps the state keeps the average
+  battery.percentage = 79.0;
+  backend->change(battery);
+  battery.energy_rate = 20.0;
+  backend->change_energy_rate(battery);
+  EXPECT_ENERGY_RATE_EVENTUALLY(13.0, battery.path);
+
+  // a new state starts over from the next sample
+  battery.state = UP_DEVICE_STATE_CHARGING;
+  backend->change(battery);
+  battery.energy_rate = 30.0;
+  backend->change_energy_rate(battery);
+  EXPECT_ENERGY_RATE_EVENTUALLY(30.0, battery.path);
+}
+
+/* a rate reported as negative, e.g. while charging, is shown as its magnitude */
+TEST_F(UPowerEnergyRateTest, NegativeRate)
+{
+  set_show_power(true);
+
+  // the first sample, from GetAll()
+  auto battery = make_battery("BAT0", 80.0);
+  battery.state = UP_DEVICE_STATE_CHARGING;
+  battery.energy_rate = -10.0;
+  backend->add(battery);
+  EXPECT_DEVICES_EVENTUALLY({battery});
+  EXPECT_ENERGY_RATE_EVENTUALLY(10.0, battery.path);
+
+  // and the ones after it
+  battery.energy_rate = -20.0;
+  backend->change_energy_rate(battery);
+  EXPECT_ENERGY_RATE_EVENTUALLY(13.0, battery.path); // 10 + 0.3 * (20 - 10)
+}
+
+/* EnergyRate is only tracked while show-power is set */
+TEST_F(UPowerEnergyRateTest, ShowPowerToggle)
+{
+  auto battery = make_battery("BAT0", 80.0);
+  battery.energy_rate = 10.0;
+  backend->add(battery);
+  EXPECT_DEVICES_EVENTUALLY({battery});
+
+  backend->change_energy_rate(battery);
+  wait_msec(200);
+  EXPECT_DOUBLE_EQ(0.0, energy_rate(battery.path));
+
+  // turning it on fetches the current rate
+  set_show_power(true);
+  EXPECT_ENERGY_RATE_EVENTUALLY(10.0, battery.path);
+
+  // turning it off forgets it
+  changed_count = 0;
+  set_show_power(false);
+  EXPECT_DOUBLE_EQ(0.0, energy_rate(battery.path));
+  EXPECT_LT(0, changed_count);
+
+  // and the average starts over when it's turned back on
+  battery.energy_rate = 20.0;
+  set_show_power(true);
+  EXPECT_ENERGY_RATE_EVENTUALLY(20.0, battery.path);
+}
@@ -0,0 +1,433 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "glib-fixture.h"
+
+#include "device.h"
+#include "device-table.h"
+#include "notifier.h"
+#include "service.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm> // std::find(), std::max()
+#include <cmath> // NAN
+#include <random>
+#include <string>
+#include <vector>
+
+/***
+****  Reference bucket and level functions, written out as the
+****  if-chains that the thresholds were specified with
+***/
+
+namespace
+{
+  guint8 reference_icon_index(double p)
+  {
+    if (p >= 95) return 10;
+    if (p >= 85) return 9;
+    if (p >= 75) return 8;
+    if (p >= 65) return 7;
+    if (p >= 55) return 6;
+    if (p >= 45) return 5;
+    if (p >= 35) return 4;
+    if (p >= 21) return 3;
+    if (p >= 15) return 2;
+    if (p >=  5) return 1;
+    return 0;
+  }
+
+  guint8 reference_fallback_icon_index(double p)
+  {
+    if (p >= 90) return 5;
+    if (p >= 70) return 4;
+    if (p >= 50) return 3;
+    if (p >  20) return 2;
+    if (p >= 10) return 1;
+    return 0;
+  }
+
+  guint8 reference_power_level(UpDeviceKind kind, double p)
+  {
+    if (kind != UP_DEVICE_KIND_BATTERY) return INDICATOR_POWER_LEVEL_OK;
+    if (p <= 2) return INDICATOR_POWER_LEVEL_CRITICAL;
+    if (p <= 5) return INDICATOR_POWER_LEVEL_VERY_LOW;
+    if (p <= 10) return INDICATOR_POWER_LEVEL_LOW;
+    return INDICATOR_POWER_LEVEL_OK;
+  }
+
+  gint compare_devices(gconstpointer a, gconstpointer b)
+  {
+    return indicator_power_service_compare_devices(static_cast<const IndicatorPowerDevice*>(a),
+                                                   static_cast<const IndicatorPowerDevice*>(b));
+  }
+}
+
+/***
+****
+***/
+
+class DeviceTableTest: public GlibFixture
+{
+  private:
+
+    typedef GlibFixture super;
+
+  protected:
+
+    std::mt19937 rng {20260101};
+
+    std::vector<IndicatorPowerDevice*> devices;
+
+    void TearDown() override
+    {
+      clear_devices();
+
+      super::TearDown();
+    }
+
+    void clear_devices()
+    {
+      for (auto device : devices)
+        g_object_unref(device);
+      devices.clear();
+    }
+
+    IndicatorPowerDevice* add_device(UpDeviceKind kind, double percentage, UpDeviceState state, time_t time, bool power_supply)
+    {
+      auto path = g_strdup_printf("/org/freedesktop/UPower/devices/test_%zu", devices.size());
+      auto device = indicator_power_device_new(path, kind, percentage, state, time, power_supply);
+      g_free(path);
+      devices.push_back(device);
+      return device;
+    }
+
+    // percentages on a 0.01% grid, so none of them are closer
+    // than INDICATOR_POWER_DEVICE_TABLE_PERCENT_QUANTUM
+    IndicatorPowerDevice* add_random_device()
+    {
+      static const std::vector<double> edges { 0, 2, 5, 9.99, 10, 10.01, 15, 20, 20.01, 21, 50, 95, 100 };
+      static const std::vector<time_t> times { 0, 0, 0, 59, 60, 3600 };
+
+      std::uniform_int_distribution<int> coin(0, 1);
+      const auto kind = UpDeviceKind(std::uniform_int_distribution<int>(0, UP_DEVICE_KIND_LAST-1)(rng));
+      const auto state = UpDeviceState(std::uniform_int_distribution<int>(0, UP_DEVICE_STATE_LAST-1)(rng));
+      const double percentage = coin(rng)
+        ? edges[std::uniform_int_distribution<size_t>(0, edges.size()-1)(rng)]
+        : std::uniform_int_distribution<int>(0, 10000)(rng) / 100.0;
+      const time_t time = coin(rng)
+        ? times[std::uniform_int_distribution<size_t>(0, times.size()-1)(rng)]
+        : time_t(std::uniform_int_distribution<int>(0, 86400)(rng));
+
+      return add_device(kind, percentage, state, time, coin(rng));
+    }
+
+    GList* device_list()
+    {
+      GList* list = nullptr;
+      for (auto it=devices.rbegin(), end=devices.rend(); it!=end; ++it)
+        list = g_list_prepend(list, *it);
+      return list;
+    }
+
+    IndicatorPowerDeviceTable* create_table()
+    {
+      auto list = device_list();
+      auto table = indicator_power_device_table_new_from_list(list);
+      g_list_free(list);
+      indicator_power_device_table_compute(table);
+      return table;
+    }
+
+    // the index of the device that the service's sort puts first
+    size_t sorted_first()
+    {
+      auto list = g_list_sort(device_list(), compare_devices);
+      const auto it = std::find(devices.begin(), devices.end(), list->data);
+      g_list_free(list);
+      return it - devices.begin();
+    }
+};
+
+/***
+****
+***/
+
+TEST_F(DeviceTableTest, EmptyTable)
+{
+  auto table = indicator_power_device_table_new(0);
+  indicator_power_device_table_compute(table);
+  guint first {};
+  EXPECT_FALSE(indicator_power_device_table_find_first(table, &first));
+  indicator_power_device_table_free(table);
+
+  indicator_power_device_table_free(nullptr);
+}
+
+TEST_F(DeviceTableTest, BucketsAndLevels)
+{
+  std::vector<double> percentages;
+  for (int i=-10; i<=1100; ++i)
+    percentages.push_back(i/10.0);
+  for (double edge : { 2.0, 5.0, 10.0, 15.0, 20.0, 21.0, 50.0, 95.0 })
+    {
+      percentages.push_back(std::nextafter(edge, 0.0));
+      percentages.push_back(std::nextafter(edge, 200.0));
+    }
+  percentages.push_back(NAN);
+
+  // out-of-range percentages can't be set on a device, so fill the columns directly
+  const guint n = percentages.size() * 2;
+  auto table = indicator_power_device_table_new(n);
+  for (guint i=0; i<n; ++i)
+    {
+      table->percentages[i] = percentages[i/2];
+      table->kinds[i] = i%2 ? UP_DEVICE_KIND_MOUSE : UP_DEVICE_KIND_BATTERY;
+      table->states[i] = UP_DEVICE_STATE_DISCHARGING;
+    }
+  indicator_power_device_table_compute(table);
+
+  for (guint i=0; i<n; ++i)
+    {
+      const auto p = table->percentages[i];
+      const auto kind = UpDeviceKind(table->kinds[i]);
+
+      // the batch kernels, which may be vectorized clones...
+      EXPECT_EQ(reference_icon_index(p), table->icon_indices[i]) << p;
+      EXPECT_EQ(reference_fallback_icon_index(p), table->fallback_icon_indices[i]) << p;
+      EXPECT_EQ(reference_power_level(kind, p), table->power_levels[i]) << p;
+
+      // ...and the per-device helpers that device.c and the notifier use
+      EXPECT_EQ(reference_icon_index(p), indicator_power_device_table_get_icon_index(p)) << p;
+      EXPECT_EQ(reference_fallback_icon_index(p), indicator_power_device_table_get_fallback_icon_index(p)) << p;
+      if (kind == UP_DEVICE_KIND_BATTERY)
+        {
+          EXPECT_EQ(reference_power_level(kind, p), guint8(indicator_power_device_table_get_power_level(p))) << p;
+        }
+    }
+
+  indicator_power_device_table_free(table);
+}
+
+TEST_F(DeviceTableTest, IconsMatchDevice)
+{
+  for (int i=0; i<=1000; ++i)
+    add_device(UP_DEVICE_KIND_BATTERY, i/10.0, i%2 ? UP_DEVICE_STATE_CHARGING : UP_DEVICE_STATE_DISCHARGING, 0, true);
+
+  auto table = create_table();
+
+  for (size_t i=0; i<devices.size(); ++i)
+    {
+      auto expected = indicator_power_device_get_gicon(devices[i]);
+      auto actual = indicator_power_device_get_gicon_for_buckets(devices[i],
+                                                                 table->icon_indices[i],
+                                                                 table->fallback_icon_indices[i]);
+      EXPECT_TRUE(g_icon_equal(expected, actual)) << table->percentages[i];
+      g_object_unref(actual);
+      g_object_unref(expected);
+    }
+
+  indicator_power_device_table_free(table);
+}
+
+TEST_F(DeviceTableTest, PowerLevelsMatchNotifier)
+{
+  const char* strings[] = {
+    POWER_LEVEL_STR_CRITICAL,
+    POWER_LEVEL_STR_VERY_LOW,
+    POWER_LEVEL_STR_LOW,
+    POWER_LEVEL_STR_OK
+  };
+
+  for (int i=0; i<=1000; ++i)
+    add_device(UP_DEVICE_KIND_BATTERY, i/10.0, UP_DEVICE_STATE_DISCHARGING, 0, true);
+
+  auto table = create_table();
+
+  for (size_t i=0; i<devices.size(); ++i)
+    {
+      ASSERT_LT(size_t(table->power_levels[i]), G_N_ELEMENTS(strings));
+      EXPECT_STREQ(strings[table->power_levels[i]], indicator_power_notifier_get_power_level(devices[i])) << table->percentages[i];
+    }
+
+  indicator_power_device_table_free(table);
+}
+
+// find_first() relies on this: whenever two priorities differ,
+// the comparator orders that pair the same way, both ways round.
+TEST_F(DeviceTableTest, PrioritiesMatchComparator)
+{
+  constexpr size_t n = 2000;
+
+  for (size_t i=0; i<n; ++i)
+    add_random_device();
+
+  auto table = create_table();
+
+  for (size_t i=0; i<n; ++i)
+    {
+      for (size_t j=0; j<n; ++j)
+        {
+          const auto ab = indicator_power_service_compare_devices(devices[i], devices[j]);
+          const auto ba = indicator_power_service_compare_devices(devices[j], devices[i]);
+          const auto a = table->priorities[i];
+          const auto b = table->priorities[j];
+
+          if (a < b)
+            ASSERT_TRUE((ab < 0) && (ba > 0)) << i << ' ' << j;
+          else if (a > b)
+            ASSERT_TRUE((ab > 0) && (ba < 0)) << i << ' ' << j;
+          else // on this grid, equal priorities are the comparator's ties
+            ASSERT_TRUE((ab >= 0) && (ba >= 0)) << i << ' ' << j;
+        }
+    }
+
+  indicator_power_device_table_free(table);
+}
+
+TEST_F(DeviceTableTest, FindFirstMatchesSort)
+{
+  constexpr int n_sets = 20000;
+  int n_found = 0;
+
+  for (int set=0; set<n_sets; ++set)
+    {
+      clear_devices();
+      const auto n = std::uniform_int_distribution<int>(1, 6)(rng);
+      for (int i=0; i<n; ++i)
+        add_random_device();
+
+      auto table = create_table();
+      guint first {};
+      if (indicator_power_device_table_find_first(table, &first))
+        {
+          ASSERT_EQ(sorted_first(), size_t(first)) << "set " << set;
+          ++n_found;
+        }
+      indicator_power_device_table_free(table);
+    }
+
+  // and the fast path should settle most of them
+  EXPECT_GT(n_found, n_sets / 2);
+}
+
+TEST_F(DeviceTableTest, FindFirstGivesUp)
+{
+  guint first {};
+
+  // a shared lowest priority
+  add_device(UP_DEVICE_KIND_BATTERY, 50, UP_DEVICE_STATE_CHARGING, 0, true);
+  add_device(UP_DEVICE_KIND_BATTERY, 60, UP_DEVICE_STATE_CHARGING, 0, true);
+  auto table = create_table();
+  EXPECT_FALSE(indicator_power_device_table_find_first(table, &first));
+  indicator_power_device_table_free(table);
+
+  // a NaN percentage, which the comparator ties with everything
+  table = indicator_power_device_table_new(2);
+  table->percentages[0] = 5;
+  table->percentages[1] = NAN;
+  table->states[0] = table->states[1] = UP_DEVICE_STATE_DISCHARGING;
+  indicator_power_device_table_compute(table);
+  EXPECT_FALSE(indicator_power_device_table_find_first(table, &first));
+  indicator_power_device_table_free(table);
+
+  // a negative time, which doesn't fit the priority.
+  // (not batteries, so that the service doesn't total them)
+  clear_devices();
+  add_device(UP_DEVICE_KIND_UPS, 50, UP_DEVICE_STATE_DISCHARGING, 600, true);
+  add_device(UP_DEVICE_KIND_UPS, 50, UP_DEVICE_STATE_DISCHARGING, -60, true);
+  table = create_table();
+  EXPECT_FALSE(indicator_power_device_table_find_first(table, &first));
+  indicator_power_device_table_free(table);
+
+  // and the service still picks the one that the sort puts first
+  auto list = device_list();
+  auto primary = indicator_power_service_choose_primary_device(list);
+  EXPECT_EQ(devices[sorted_first()], primary);
+  g_clear_object(&primary);
+  g_list_free(list);
+}
+
+/***
+****  Per-device cost at scale
+***/
+
+/**
+ * Compares the batch pass with computing the same keys one device at a
+ * time through the getters. Wall-clock time on a shared build host is
+ * too noisy to fail on, so the numbers are only reported unless
+ * INDICATOR_POWER_TEST_BENCHMARK is set.
+ */
+TEST_F(DeviceTableTest, Benchmark)
+{
+  constexpr size_t ops_per_size = 1000000;
+  const size_t sizes[] = { 16, 256, 4096, 65536 };
+
+  for (const auto n : sizes)
+    {
+      clear_devices();
+      for (size_t i=0; i<n; ++i)
+        add_random_device();
+
+      auto list = device_list();
+      auto table = indicator_power_device_table_new_from_list(list);
+      const auto rounds = std::max(size_t(1), ops_per_size / n);
+      guint sink = 0;
+
+      // one device at a time through the getters
+      auto start = g_get_monotonic_time();
+      for (size_t r=0; r<rounds; ++r)
+        {
+          for (auto device : devices)
+            {
+              const auto p = indicator_power_device_get_percentage(device);
+              sink += indicator_power_device_table_get_icon_index(p);
+              sink += indicator_power_device_table_get_fallback_icon_index(p);
+              if (indicator_power_device_get_kind(device) == UP_DEVICE_KIND_BATTERY)
+                sink += indicator_power_device_table_get_power_level(p);
+            }
+          auto sorted = g_list_sort(g_list_copy(list), compare_devices);
+          sink += GPOINTER_TO_UINT(sorted->data) & 1;
+          g_list_free(sorted);
+        }
+      const double single_nsec = 1000.0 * (g_get_monotonic_time() - start) / (rounds * n);
+
+      // the batch pass, including copying the devices into the table
+      start = g_get_monotonic_time();
+      for (size_t r=0; r<rounds; ++r)
+        {
+          guint first {};
+          for (size_t i=0; i<n; ++i)
+            indicator_power_device_table_set_device(table, i, devices[i]);
+          indicator_power_device_table_compute(table);
+          sink += indicator_power_device_table_find_first(table, &first) ? first : 0;
+        }
+      const double batch_nsec = 1000.0 * (g_get_monotonic_time() - start) / (rounds * n);
+
+      indicator_power_device_table_free(table);
+      g_list_free(list);
+
+      const auto prefix = std::to_string(n) + "_devices_";
+      RecordProperty(prefix + "single_nsec_per_device", std::to_string(single_nsec));
+      RecordProperty(prefix + "batch_nsec_per_device", std::to_string(batch_nsec));
+      g_message("%zu devices: %.2f nsec/device one at a time, %.2f batch (%u)",
+                n, single_nsec, batch_nsec, sink);
+
+      if (g_getenv("INDICATOR_POWER_TEST_BENCHMARK") != nullptr)
+        EXPECT_LT(batch_nsec, single_nsec);
+    }
+}
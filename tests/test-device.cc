@@ -95,32 +95,32 @@ class DeviceTest : public ::testing::Test
       char * a11y = NULL;
       char * title = NULL;
 
-      title = indicator_power_device_get_readable_title (device, true, true);
+      title = indicator_power_device_get_readable_title (device, true, true, false);
       if (expected_time_and_percent)
         EXPECT_STREQ (expected_time_and_percent, title);
       else
         EXPECT_EQ(NULL, title);
       g_free (title);
 
-      title = indicator_power_device_get_readable_title (device, true, false);
+      title = indicator_power_device_get_readable_title (device, true, false, false);
       if (expected_time)
         EXPECT_STREQ (expected_time, title);
       else
         EXPECT_EQ(NULL, title);
       g_free (title);
 
-      title = indicator_power_device_get_readable_title (device, false, true);
+      title = indicator_power_device_get_readable_title (device, false, true, false);
       if (expected_percent)
         EXPECT_STREQ (expected_percent, title);
       else
         EXPECT_EQ(NULL, title);
       g_free (title);
 
-      title = indicator_power_device_get_readable_title (device, false, false);
+      title = indicator_power_device_get_readable_title (device, false, false, false);
       EXPECT_EQ(NULL, title);
       g_free (title);
 
-      a11y = indicator_power_device_get_accessible_title (device, false, false);
+      a11y = indicator_power_device_get_accessible_title (device, false, false, false);
       if (expected_a11y)
         EXPECT_STREQ (expected_a11y, a11y);
       else
@@ -195,6 +195,12 @@ TEST_F(DeviceTest, Properties)
   g_object_get (o, key, &u64, NULL);
   ASSERT_EQ(u64, 30);
 
+  // ENERGY_RATE
+  key = INDICATOR_POWER_DEVICE_ENERGY_RATE;
+  g_object_set (o, key, 12.3, NULL);
+  g_object_get (o, key, &d, NULL);
+  ASSERT_DOUBLE_EQ(d, 12.3);
+
   // cleanup
   g_object_unref (o);
 }
@@ -246,6 +252,41 @@ TEST_F(DeviceTest, NewFromVariant)
   g_variant_unref (variant);
 }
 
+TEST_F(DeviceTest, Copy)
+{
+  // set our language so that i18n won't break these tests
+  auto real_lang = g_strdup(g_getenv ("LANG"));
+  g_setenv ("LANG", "en_US.UTF-8", true);
+
+  // percentage but no time estimate, so it's "estimating…"
+  auto device = indicator_power_device_new ("/object/path",
+                                            UP_DEVICE_KIND_BATTERY,
+                                            50.0,
+                                            UP_DEVICE_STATE_DISCHARGING,
+                                            0,
+                                            TRUE);
+  auto copy = indicator_power_device_copy (device);
+  ASSERT_TRUE (copy != NULL);
+  ASSERT_TRUE (copy != device);
+  ASSERT_EQ (UP_DEVICE_KIND_BATTERY, indicator_power_device_get_kind(copy));
+  ASSERT_EQ (UP_DEVICE_STATE_DISCHARGING, indicator_power_device_get_state(copy));
+  ASSERT_STREQ ("/object/path", indicator_power_device_get_object_path(copy));
+  ASSERT_EQ (50, int(indicator_power_device_get_percentage(copy)));
+  ASSERT_EQ (0, indicator_power_device_get_time(copy));
+  ASSERT_TRUE (indicator_power_device_get_power_supply(copy));
+  check_label (copy, "Battery (estimating…)");
+
+  // the copy is a snapshot: later changes to the device don't reach it
+  g_object_set (device, INDICATOR_POWER_DEVICE_PERCENTAGE, 40.0, nullptr);
+  ASSERT_EQ (50, int(indicator_power_device_get_percentage(copy)));
+
+  // cleanup
+  g_object_unref (copy);
+  g_object_unref (device);
+  g_setenv ("LANG", real_lang, TRUE);
+  g_free (real_lang);
+}
+
 TEST_F(DeviceTest, BadAccessors)
 {
   // test that these functions can handle being passed NULL pointers
@@ -662,6 +703,78 @@ TEST_F(DeviceTest, Labels)
   g_free (real_lang);
 }
 
+TEST_F(DeviceTest, PowerLabels)
+{
+  // set our language so that i18n won't break these tests
+  char * real_lang = g_strdup(g_getenv ("LANG"));
+  g_setenv ("LANG", "en_US.UTF-8", TRUE);
+
+  IndicatorPowerDevice * device = INDICATOR_POWER_DEVICE (g_object_new (INDICATOR_POWER_DEVICE_TYPE, NULL));
+  GObject * o = G_OBJECT(device);
+  char * str;
+
+  // discharging with a known rate
+  g_object_set (o, INDICATOR_POWER_DEVICE_KIND, UP_DEVICE_KIND_BATTERY,
+                   INDICATOR_POWER_DEVICE_STATE, UP_DEVICE_STATE_DISCHARGING,
+                   INDICATOR_POWER_DEVICE_PERCENTAGE, 50.0,
+                   INDICATOR_POWER_DEVICE_TIME, guint64(60*102),
+                   INDICATOR_POWER_DEVICE_ENERGY_RATE, 12.3,
+                   NULL);
+  check_label (device, "Battery (1:42 left, 12.3 W)");
+  str = indicator_power_device_get_accessible_text (device);
+  EXPECT_STREQ ("Battery (1 hour 42 minutes left, 12.3 watts)", str);
+  g_free (str);
+
+  // the header only shows the rate when asked to
+  str = indicator_power_device_get_readable_title (device, true, true, true);
+  EXPECT_STREQ ("(1:42, 50%, 12.3 W)", str);
+  g_free (str);
+  str = indicator_power_device_get_readable_title (device, true, false, true);
+  EXPECT_STREQ ("(1:42, 12.3 W)", str);
+  g_free (str);
+  str = indicator_power_device_get_readable_title (device, false, true, true);
+  EXPECT_STREQ ("(50%, 12.3 W)", str);
+  g_free (str);
+  str = indicator_power_device_get_readable_title (device, false, false, true);
+  EXPECT_STREQ ("(12.3 W)", str);
+  g_free (str);
+  str = indicator_power_device_get_readable_title (device, true, true, false);
+  EXPECT_STREQ ("(1:42, 50%)", str);
+  g_free (str);
+
+  // and so does the accessible header, to match
+  str = indicator_power_device_get_accessible_title (device, true, true, true);
+  EXPECT_STREQ ("Battery (1 hour 42 minutes left, 12.3 watts)", str);
+  g_free (str);
+  str = indicator_power_device_get_accessible_title (device, true, true, false);
+  EXPECT_STREQ ("Battery (1 hour 42 minutes left)", str);
+  g_free (str);
+
+  // discharging with > 24 hours left: no time, but still the rate
+  g_object_set (o, INDICATOR_POWER_DEVICE_TIME, guint64(60*60*25), NULL);
+  check_label (device, "Battery (12.3 W)");
+
+  // no rate known
+  g_object_set (o, INDICATOR_POWER_DEVICE_TIME, guint64(60*102),
+                   INDICATOR_POWER_DEVICE_ENERGY_RATE, 0.0,
+                   NULL);
+  check_label (device, "Battery (1:42 left)");
+  str = indicator_power_device_get_readable_title (device, false, false, true);
+  EXPECT_EQ (NULL, str);
+  g_free (str);
+
+  // fully charged: the rate doesn't matter
+  g_object_set (o, INDICATOR_POWER_DEVICE_STATE, UP_DEVICE_STATE_FULLY_CHARGED,
+                   INDICATOR_POWER_DEVICE_ENERGY_RATE, 1.5,
+                   NULL);
+  check_label (device, "Battery (charged)");
+
+  // cleanup
+  g_object_unref(o);
+  g_setenv ("LANG", real_lang, TRUE);
+  g_free (real_lang);
+}
+
 
 TEST_F(DeviceTest, Inestimable___this_takes_80_seconds)
 {
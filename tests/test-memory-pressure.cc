@@ -0,0 +1,192 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "glib-fixture.h"
+
+#include "memory-pressure.h"
+
+#include <gtest/gtest.h>
+
+#include <gio/gio.h>
+
+#include <cstdlib> // malloc(), free()
+#include <cstring> // memset()
+#include <vector>
+
+/***
+****  A GMemoryMonitor whose warnings are raised by hand
+***/
+
+typedef struct { GObject parent; } FakeMemoryMonitor;
+typedef struct { GObjectClass parent_class; } FakeMemoryMonitorClass;
+
+static gboolean
+fake_memory_monitor_initable_init (GInitable*, GCancellable*, GError**)
+{
+  return TRUE;
+}
+
+static void
+fake_memory_monitor_initable_iface_init (GInitableIface * iface)
+{
+  iface->init = fake_memory_monitor_initable_init;
+}
+
+static void
+fake_memory_monitor_iface_init (GMemoryMonitorInterface*)
+{
+}
+
+G_DEFINE_TYPE_WITH_CODE (FakeMemoryMonitor, fake_memory_monitor, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE, fake_memory_monitor_initable_iface_init)
+                         G_IMPLEMENT_INTERFACE (G_TYPE_MEMORY_MONITOR, fake_memory_monitor_iface_init))
+
+static void
+fake_memory_monitor_init (FakeMemoryMonitor*)
+{
+}
+
+static void
+fake_memory_monitor_class_init (FakeMemoryMonitorClass*)
+{
+}
+
+/***
+****
+***/
+
+class MemoryPressureTest: public GlibFixture
+{
+  private:
+
+    typedef GlibFixture super;
+
+  protected:
+
+    GMemoryMonitor * monitor {};
+    IndicatorPowerMemoryPressure * pressure {};
+    std::vector<GMemoryMonitorWarningLevel> sheds;
+
+    // a stand-in for a rebuildable cache: lots of small heap blocks
+    std::vector<void*> cache;
+
+    void SetUp() override
+    {
+      super::SetUp();
+
+      monitor = G_MEMORY_MONITOR(g_object_new(fake_memory_monitor_get_type(), nullptr));
+      pressure = indicator_power_memory_pressure_new(monitor);
+      g_signal_connect(pressure, INDICATOR_POWER_MEMORY_PRESSURE_SIGNAL_SHED,
+                       G_CALLBACK(+[](IndicatorPowerMemoryPressure*, GMemoryMonitorWarningLevel level, gpointer gself){
+                         auto self = static_cast<MemoryPressureTest*>(gself);
+                         self->sheds.push_back(level);
+                         self->drop_cache();
+                       }), this);
+    }
+
+    void TearDown() override
+    {
+      g_clear_object(&pressure);
+      g_clear_object(&monitor);
+      drop_cache();
+
+      super::TearDown();
+    }
+
+    void warn(GMemoryMonitorWarningLevel level)
+    {
+      g_signal_emit_by_name(monitor, "low-memory-warning", level);
+    }
+
+    void fill_cache(size_t n_bytes)
+    {
+      constexpr size_t block_size {256};
+
+      for (size_t i=0; i<n_bytes/block_size; ++i)
+        {
+          auto block = malloc(block_size);
+          memset(block, 0xAA, block_size);
+          cache.push_back(block);
+        }
+    }
+
+    void drop_cache()
+    {
+      for (auto block : cache)
+        free(block);
+      cache.clear();
+      cache.shrink_to_fit();
+    }
+};
+
+/***
+****
+***/
+
+TEST_F(MemoryPressureTest, ShedsOnEveryWarningLevel)
+{
+  warn(G_MEMORY_MONITOR_WARNING_LEVEL_LOW);
+  warn(G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM);
+  warn(G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL);
+
+  const std::vector<GMemoryMonitorWarningLevel> expected {
+    G_MEMORY_MONITOR_WARNING_LEVEL_LOW,
+    G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM,
+    G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL
+  };
+  EXPECT_EQ(expected, sheds);
+}
+
+TEST_F(MemoryPressureTest, StopsListeningWhenDestroyed)
+{
+  g_clear_object(&pressure);
+  warn(G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL);
+  EXPECT_TRUE(sheds.empty());
+}
+
+#ifdef __GLIBC__
+
+// The blocks freed by the shed handler sit below the heap blocks that
+// are still in use, so glibc keeps them until malloc_trim() returns them.
+TEST_F(MemoryPressureTest, ReportsReleasedBytes)
+{
+  constexpr size_t cache_size {32*1024*1024};
+
+  int notify_count {};
+  g_signal_connect(pressure, "notify::" INDICATOR_POWER_MEMORY_PRESSURE_PROP_BYTES_RELEASED,
+                   G_CALLBACK(+[](GObject*, GParamSpec*, gpointer gcount){
+                     ++*static_cast<int*>(gcount);
+                   }), &notify_count);
+
+  fill_cache(cache_size);
+  auto pinned = malloc(256);
+  warn(G_MEMORY_MONITOR_WARNING_LEVEL_LOW);
+  free(pinned);
+
+  const auto released = indicator_power_memory_pressure_get_bytes_released(pressure);
+  EXPECT_GE(released, guint64(cache_size/2));
+  EXPECT_EQ(1, notify_count);
+
+  guint64 property {};
+  g_object_get(pressure, INDICATOR_POWER_MEMORY_PRESSURE_PROP_BYTES_RELEASED, &property, nullptr);
+  EXPECT_EQ(released, property);
+
+  // with nothing left to give back, the total stays put
+  indicator_power_memory_pressure_shed(pressure, G_MEMORY_MONITOR_WARNING_LEVEL_LOW);
+  EXPECT_LE(indicator_power_memory_pressure_get_bytes_released(pressure) - released, guint64(cache_size/8));
+}
+
+#endif
@@ -0,0 +1,827 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "glib-fixture.h"
+
+#include "device.h"
+#include "service.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm> // std::find(), std::max()
+#include <cmath> // std::floor()
+#include <cstdint>
+#include <cstdlib> // getenv(), strtoull()
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/***
+****  Differential tests of which device drives the header.
+****
+****  Random device sets are run through the service's helpers and
+****  through a reference copy of their semantics, and any disagreement
+****  is shrunk to a minimal case before it's reported.
+****
+****  By default every run uses the same seed and a short loop, so that
+****  results are reproducible. INDICATOR_POWER_TEST_SEED and
+****  INDICATOR_POWER_TEST_ITERATIONS can be set to explore other sets
+****  or to run longer, e.g. 1000000 iterations for a soak run.
+***/
+
+namespace
+{
+
+struct Spec
+{
+  UpDeviceKind kind;
+  UpDeviceState state;
+  double percentage;
+  time_t time;
+  bool power_supply;
+  double energy_rate;
+};
+
+bool operator==(const Spec& a, const Spec& b)
+{
+  return (a.kind == b.kind)
+      && (a.state == b.state)
+      && (a.percentage == b.percentage)
+      && (a.time == b.time)
+      && (a.power_supply == b.power_supply)
+      && (a.energy_rate == b.energy_rate);
+}
+
+std::string to_string(const Spec& s)
+{
+  char buf[256];
+  g_snprintf(buf, sizeof(buf), "{ %s, state %d, %.17g%%, %llds, %s, %.17g W }",
+             indicator_power_device_kind_to_string(s.kind),
+             int(s.state),
+             s.percentage,
+             (long long)s.time,
+             s.power_supply ? "power supply" : "not power supply",
+             s.energy_rate);
+  return buf;
+}
+
+std::string to_string(const std::vector<Spec>& specs)
+{
+  std::string str;
+  for (size_t i=0; i<specs.size(); ++i)
+    str += "\n  #" + std::to_string(i) + ' ' + to_string(specs[i]);
+  return str;
+}
+
+Spec spec_of(const IndicatorPowerDevice* device)
+{
+  return Spec {
+    indicator_power_device_get_kind(device),
+    indicator_power_device_get_state(device),
+    indicator_power_device_get_percentage(device),
+    indicator_power_device_get_time(device),
+    bool(indicator_power_device_get_power_supply(device)),
+    indicator_power_device_get_energy_rate(device)
+  };
+}
+
+int sign(int i)
+{
+  return (i > 0) - (i < 0);
+}
+
+/***
+****  The reference.
+****
+****  This is today's behavior written out as plainly as possible, and it's
+****  meant to stay frozen: if a change to the service is *supposed* to pick
+****  a different device, change this too and say so in the commit message.
+***/
+
+namespace reference
+{
+
+int kind_weight(UpDeviceKind kind)
+{
+  if (kind == UP_DEVICE_KIND_BATTERY)
+    return 2;
+  if (kind == UP_DEVICE_KIND_LINE_POWER)
+    return 0;
+  return 1;
+}
+
+bool is_charging(const Spec& s) { return s.state == UP_DEVICE_STATE_CHARGING; }
+bool is_discharging(const Spec& s) { return s.state == UP_DEVICE_STATE_DISCHARGING; }
+bool is_unknown(const Spec& s) { return s.state == UP_DEVICE_STATE_UNKNOWN; }
+
+// negative if a is more interesting than b, positive if less
+int compare(const Spec& a, const Spec& b)
+{
+  // the device that powers the system wins
+  if (a.power_supply != b.power_supply)
+    return a.power_supply ? -1 : 1;
+
+  // discharging with no estimate and more than 10% left always loses
+  if (is_discharging(a) && !a.time && (a.percentage > 10))
+    return 1;
+  if (is_discharging(b) && !b.time && (b.percentage > 10))
+    return -1;
+
+  // discharging with an estimate: least time left first
+  if ((is_discharging(a) && a.time) || (is_discharging(b) && b.time))
+    {
+      if (!is_discharging(a))
+        return 1;
+      if (!is_discharging(b))
+        return -1;
+      if (!a.time || !b.time)
+        return a.time ? -1 : 1;
+      if (a.time != b.time)
+        return a.time < b.time ? -1 : 1;
+      return a.percentage < b.percentage ? -1 : 1;
+    }
+
+  // charging: most time left to charge first, known times before unknown
+  if (is_charging(a) || is_charging(b))
+    {
+      if (!is_charging(a))
+        return 1;
+      if (!is_charging(b))
+        return -1;
+      if (!a.time || !b.time)
+        return a.time ? -1 : 1;
+      if (a.time != b.time)
+        return a.time > b.time ? -1 : 1;
+      return a.percentage < b.percentage ? -1 : 1;
+    }
+
+  // the rest of the discharging devices, lowest percentage first
+  if (is_discharging(a) || is_discharging(b))
+    {
+      if (!is_discharging(a))
+        return 1;
+      if (!is_discharging(b))
+        return -1;
+      return a.percentage < b.percentage ? -1 : 1;
+    }
+
+  // avoid devices in an unknown state
+  if (is_unknown(a) != is_unknown(b))
+    return is_unknown(a) ? 1 : -1;
+
+  // batteries, then everything else, then line power
+  if (kind_weight(a.kind) != kind_weight(b.kind))
+    return kind_weight(a.kind) > kind_weight(b.kind) ? -1 : 1;
+
+  return int(a.state) - int(b.state);
+}
+
+void count_batteries(const std::vector<Spec>& specs, int& total, int& inuse)
+{
+  for (const auto& s : specs)
+    {
+      if ((s.kind != UP_DEVICE_KIND_BATTERY) && (s.kind != UP_DEVICE_KIND_UPS))
+        continue;
+
+      ++total;
+      if (is_charging(s) || is_discharging(s))
+        ++inuse;
+    }
+}
+
+// Returns true and sets `merged` if there are enough batteries to total
+bool totalled(const std::vector<Spec>& specs, Spec& merged)
+{
+  int n_batteries = 0;
+  int n_charging = 0;
+  int n_discharging = 0;
+  int n_charged = 0;
+  double sum_percent = 0;
+  double sum_energy_rate = 0;
+  time_t max_charge_time = 0;
+  time_t max_discharge_time = 0;
+  time_t sum_charged_time = 0;
+
+  for (const auto& s : specs)
+    {
+      if (s.kind != UP_DEVICE_KIND_BATTERY)
+        continue;
+
+      sum_energy_rate += s.energy_rate;
+
+      // batteries that report ~0% don't count towards the average
+      if (s.percentage > 0.01)
+        {
+          sum_percent += s.percentage;
+          ++n_batteries;
+        }
+
+      if (is_charging(s))
+        {
+          ++n_charging;
+          max_charge_time = std::max(max_charge_time, s.time);
+        }
+      else if (is_discharging(s))
+        {
+          ++n_discharging;
+          max_discharge_time = std::max(max_discharge_time, s.time);
+        }
+      else if (s.state == UP_DEVICE_STATE_FULLY_CHARGED)
+        {
+          ++n_charged;
+          sum_charged_time += s.time;
+        }
+    }
+
+  if (n_batteries < 2)
+    return false;
+
+  merged.kind = UP_DEVICE_KIND_BATTERY;
+  merged.percentage = sum_percent / n_batteries;
+  merged.power_supply = true;
+  merged.energy_rate = sum_energy_rate;
+
+  if (n_discharging > 0)
+    {
+      merged.state = UP_DEVICE_STATE_DISCHARGING;
+      merged.time = max_discharge_time + sum_charged_time;
+    }
+  else if (n_charging > 0)
+    {
+      merged.state = UP_DEVICE_STATE_CHARGING;
+      merged.time = max_charge_time;
+    }
+  else if (n_charged > 0)
+    {
+      merged.state = UP_DEVICE_STATE_FULLY_CHARGED;
+      merged.time = 0;
+    }
+  else
+    {
+      merged.state = UP_DEVICE_STATE_UNKNOWN;
+      merged.time = 0;
+    }
+
+  return true;
+}
+
+struct Candidate
+{
+  int index;
+  Spec spec;
+};
+
+// compare() isn't a consistent ordering -- two devices that tie both
+// say "I go after you" -- so which one ends up first depends on the sort.
+// Pin that down too: a top-down merge sort that puts floor(n/2) items
+// in the left run and takes from it unless compare() says otherwise.
+// That's what g_list_sort() does.
+std::vector<Candidate> sort(const std::vector<Candidate>& in)
+{
+  if (in.size() < 2)
+    return in;
+
+  const auto mid = in.begin() + in.size()/2;
+  const auto left = sort(std::vector<Candidate>(in.begin(), mid));
+  const auto right = sort(std::vector<Candidate>(mid, in.end()));
+
+  std::vector<Candidate> out;
+  size_t l=0, r=0;
+  while ((l < left.size()) && (r < right.size()))
+    {
+      if (compare(left[l].spec, right[r].spec) <= 0)
+        out.push_back(left[l++]);
+      else
+        out.push_back(right[r++]);
+    }
+  out.insert(out.end(), left.begin()+l, left.end());
+  out.insert(out.end(), right.begin()+r, right.end());
+  return out;
+}
+
+constexpr int NO_DEVICE = -2;
+constexpr int MERGED_DEVICE = -1;
+
+// Returns the index of the primary device in `specs`,
+// MERGED_DEVICE if it's the totalled battery, or NO_DEVICE.
+int choose_primary(const std::vector<Spec>& specs)
+{
+  std::vector<Candidate> candidates;
+  Spec merged {};
+
+  if (specs.empty())
+    return NO_DEVICE;
+
+  if (totalled(specs, merged))
+    {
+      candidates.push_back(Candidate{MERGED_DEVICE, merged});
+      for (size_t i=0; i<specs.size(); ++i)
+        if (specs[i].kind != UP_DEVICE_KIND_BATTERY)
+          candidates.push_back(Candidate{int(i), specs[i]});
+    }
+  else
+    {
+      for (size_t i=0; i<specs.size(); ++i)
+        candidates.push_back(Candidate{int(i), specs[i]});
+    }
+
+  return sort(candidates).front().index;
+}
+
+} // namespace reference
+
+/***
+****  Production devices
+***/
+
+IndicatorPowerDevice* make_device(const Spec& spec, size_t serial)
+{
+  char path[64];
+  g_snprintf(path, sizeof(path), "/org/freedesktop/UPower/devices/test_%zu", serial);
+
+  auto device = indicator_power_device_new(path,
+                                           spec.kind,
+                                           spec.percentage,
+                                           spec.state,
+                                           spec.time,
+                                           spec.power_supply);
+  g_object_set(device, INDICATOR_POWER_DEVICE_ENERGY_RATE, spec.energy_rate, nullptr);
+  return device;
+}
+
+// Owns a production device for each spec
+class Devices
+{
+  public:
+
+    explicit Devices(const std::vector<Spec>& specs)
+    {
+      for (size_t i=0; i<specs.size(); ++i)
+        m_devices.push_back(make_device(specs[i], i));
+    }
+
+    ~Devices()
+    {
+      for (auto device : m_devices)
+        g_object_unref(device);
+    }
+
+    const std::vector<IndicatorPowerDevice*>& get() const { return m_devices; }
+
+  private:
+
+    std::vector<IndicatorPowerDevice*> m_devices;
+};
+
+/***
+****  The checks. Each returns an empty string if production
+****  agrees with the reference, or a description of how it doesn't.
+***/
+
+std::string check_compare(const Spec& a, IndicatorPowerDevice* da,
+                          const Spec& b, IndicatorPowerDevice* db)
+{
+  const int expected = sign(reference::compare(a, b));
+  const int actual = sign(indicator_power_service_compare_devices(da, db));
+
+  if (expected == actual)
+    return std::string();
+
+  std::ostringstream why;
+  why << "\ncompare(#0, #1) has sign " << actual << ", expected " << expected;
+  return why.str();
+}
+
+std::string check_set(const std::vector<Spec>& specs,
+                      const std::vector<IndicatorPowerDevice*>& devices)
+{
+  std::ostringstream why;
+
+  GList* list = nullptr;
+  for (auto it=devices.rbegin(), end=devices.rend(); it!=end; ++it)
+    list = g_list_prepend(list, *it);
+
+  // count_batteries()
+
+  int total=0, inuse=0;
+  int expected_total=0, expected_inuse=0;
+  indicator_power_service_count_batteries(list, &total, &inuse);
+  reference::count_batteries(specs, expected_total, expected_inuse);
+  if ((total != expected_total) || (inuse != expected_inuse))
+    why << "\ncount_batteries() found " << total << " batteries, " << inuse << " in use;"
+        << " expected " << expected_total << ", " << expected_inuse;
+
+  // create_totalled_battery_device()
+
+  Spec expected_merged {};
+  const bool expect_merged = reference::totalled(specs, expected_merged);
+  auto merged = indicator_power_service_create_totalled_battery_device(list);
+  if (merged == nullptr)
+    {
+      if (expect_merged)
+        why << "\ntotalled device is missing, expected " << to_string(expected_merged);
+    }
+  else if (!expect_merged)
+    {
+      why << "\ntotalled device " << to_string(spec_of(merged)) << " wasn't expected";
+    }
+  else if (!(spec_of(merged) == expected_merged))
+    {
+      why << "\ntotalled device is " << to_string(spec_of(merged))
+          << ", expected " << to_string(expected_merged);
+    }
+  g_clear_object(&merged);
+
+  // choose_primary_device()
+
+  const int expected_primary = reference::choose_primary(specs);
+  auto primary = indicator_power_service_choose_primary_device(list);
+  if (primary == nullptr)
+    {
+      if (expected_primary != reference::NO_DEVICE)
+        why << "\nno primary device chosen";
+    }
+  else if (expected_primary == reference::NO_DEVICE)
+    {
+      why << "\nprimary device " << to_string(spec_of(primary)) << " wasn't expected";
+    }
+  else if (expected_primary == reference::MERGED_DEVICE)
+    {
+      if ((indicator_power_device_get_object_path(primary) != nullptr) ||
+          !(spec_of(primary) == expected_merged))
+        why << "\nprimary device is " << to_string(spec_of(primary))
+            << ", expected the totalled battery";
+    }
+  else if (primary != devices[expected_primary])
+    {
+      const auto it = std::find(devices.begin(), devices.end(), primary);
+      why << "\nprimary device is ";
+      if (it != devices.end())
+        why << '#' << (it - devices.begin());
+      else
+        why << to_string(spec_of(primary));
+      why << ", expected #" << expected_primary;
+    }
+  g_clear_object(&primary);
+
+  g_list_free(list);
+  return why.str();
+}
+
+/***
+****  Shrinking
+***/
+
+// Candidates that are each one step simpler than `spec`.
+// Every step moves one field closer to a fixed value, so shrinking ends.
+std::vector<Spec> simplifications(const Spec& spec)
+{
+  std::vector<Spec> ret;
+  Spec s;
+
+  if (spec.kind != UP_DEVICE_KIND_BATTERY)
+    { s = spec; s.kind = UP_DEVICE_KIND_BATTERY; ret.push_back(s); }
+
+  if (spec.state != UP_DEVICE_STATE_UNKNOWN)
+    { s = spec; s.state = UP_DEVICE_STATE_UNKNOWN; ret.push_back(s); }
+
+  if (spec.percentage != 0)
+    { s = spec; s.percentage = 0; ret.push_back(s); }
+
+  if (spec.percentage != std::floor(spec.percentage))
+    { s = spec; s.percentage = std::floor(spec.percentage); ret.push_back(s); }
+
+  if (spec.time != 0)
+    { s = spec; s.time = 0; ret.push_back(s); }
+
+  if (spec.time % 60)
+    { s = spec; s.time -= spec.time % 60; ret.push_back(s); }
+
+  if (spec.power_supply)
+    { s = spec; s.power_supply = false; ret.push_back(s); }
+
+  if (spec.energy_rate != 0)
+    { s = spec; s.energy_rate = 0; ret.push_back(s); }
+
+  return ret;
+}
+
+// Returns an empty string if the case passes, else why it fails
+using Check = std::function<std::string(const std::vector<Spec>&)>;
+
+// Greedily shrinks a failing case: first try dropping each device,
+// then try simplifying each field, keeping whatever still fails.
+std::vector<Spec> shrink(std::vector<Spec> specs, const Check& check)
+{
+  for (bool progress=true; progress; )
+    {
+      progress = false;
+
+      for (size_t i=0; i<specs.size(); )
+        {
+          auto candidate = specs;
+          candidate.erase(candidate.begin()+i);
+          if (!check(candidate).empty())
+            {
+              specs = candidate;
+              progress = true;
+            }
+          else
+            {
+              ++i;
+            }
+        }
+
+      for (size_t i=0; i<specs.size(); ++i)
+        {
+          for (const auto& simpler : simplifications(specs[i]))
+            {
+              auto candidate = specs;
+              candidate[i] = simpler;
+              if (!check(candidate).empty())
+                {
+                  specs = candidate;
+                  progress = true;
+                  break;
+                }
+            }
+        }
+    }
+
+  return specs;
+}
+
+/***
+****  Generating devices
+***/
+
+class Generator
+{
+  public:
+
+    explicit Generator(uint32_t seed): m_rng(seed) {}
+
+    size_t below(size_t n)
+    {
+      return std::uniform_int_distribution<size_t>(0, n-1)(m_rng);
+    }
+
+    bool chance(double p)
+    {
+      return std::bernoulli_distribution(p)(m_rng);
+    }
+
+    // Mostly interesting values: batteries, ties, and the edges of
+    // the thresholds that the service and totalled device care about
+    Spec spec()
+    {
+      static const std::vector<double> percentages {
+        0, 0.005, 0.01, 0.02, 1, 5, 9.99, 10, 10.01, 50, 99.5, 100
+      };
+      static const std::vector<time_t> times {
+        1, 59, 60, 61, 600, 3599, 3600, 86400
+      };
+      static const std::vector<double> rates {
+        0.04, 0.05, 7.5, 12.25
+      };
+
+      Spec s;
+
+      s.kind = chance(0.5) ? UP_DEVICE_KIND_BATTERY
+                           : UpDeviceKind(below(UP_DEVICE_KIND_LAST));
+
+      s.state = UpDeviceState(below(UP_DEVICE_STATE_LAST));
+
+      if (chance(0.4))
+        s.percentage = percentages[below(percentages.size())];
+      else
+        s.percentage = std::uniform_real_distribution<double>(0, 100)(m_rng);
+
+      if (chance(0.35))
+        s.time = 0;
+      else if (chance(0.5))
+        s.time = times[below(times.size())];
+      else
+        s.time = time_t(below(3*86400));
+
+      s.power_supply = chance(0.7);
+
+      if (chance(0.3))
+        s.energy_rate = 0;
+      else if (chance(0.3))
+        s.energy_rate = rates[below(rates.size())];
+      else
+        s.energy_rate = std::uniform_real_distribution<double>(0, 60)(m_rng);
+
+      return s;
+    }
+
+  private:
+
+    std::mt19937 m_rng;
+};
+
+/***
+****
+***/
+
+class PrimaryDeviceTest: public GlibFixture
+{
+  private:
+
+    typedef GlibFixture super;
+
+  protected:
+
+    static constexpr uint32_t DEFAULT_SEED {20260101};
+    static constexpr size_t DEFAULT_ITERATIONS {10000};
+
+    uint32_t seed {};
+    size_t iterations {};
+
+    void SetUp() override
+    {
+      super::SetUp();
+
+      const char* str = g_getenv("INDICATOR_POWER_TEST_SEED");
+      seed = str ? uint32_t(strtoull(str, nullptr, 10)) : DEFAULT_SEED;
+      RecordProperty("seed", std::to_string(seed));
+
+      str = g_getenv("INDICATOR_POWER_TEST_ITERATIONS");
+      iterations = str ? size_t(strtoull(str, nullptr, 10)) : DEFAULT_ITERATIONS;
+    }
+
+    // A pool of devices to draw sets from, so that the loops
+    // aren't dominated by building GObjects. Some specs are
+    // repeated on purpose to exercise ties.
+    void fill_pool(Generator& gen,
+                   std::vector<Spec>& specs,
+                   std::vector<IndicatorPowerDevice*>& devices)
+    {
+      constexpr size_t POOL_SIZE = 1024;
+
+      for (auto device : devices)
+        g_object_unref(device);
+      specs.clear();
+      devices.clear();
+
+      for (size_t i=0; i<POOL_SIZE; ++i)
+        {
+          specs.push_back((i > 0) && gen.chance(0.1) ? specs[gen.below(i)] : gen.spec());
+          devices.push_back(make_device(specs.back(), i));
+        }
+    }
+
+    void report(const char* what, const std::vector<Spec>& failing, const Check& check)
+    {
+      const auto minimal = shrink(failing, check);
+      ADD_FAILURE() << what << " disagrees with the reference (seed " << seed << ")"
+                    << "\noriginal case:" << to_string(failing) << check(failing)
+                    << "\nshrunk to:" << to_string(minimal) << check(minimal);
+    }
+};
+
+TEST_F(PrimaryDeviceTest, CompareMatchesReference)
+{
+  Generator gen(seed);
+  std::vector<Spec> pool;
+  std::vector<IndicatorPowerDevice*> devices;
+
+  const Check check = [](const std::vector<Spec>& specs) {
+    if (specs.size() != 2)
+      return std::string();
+    Devices d(specs);
+    return check_compare(specs[0], d.get()[0], specs[1], d.get()[1]);
+  };
+
+  const size_t n_pairs = iterations * 2;
+  for (size_t i=0; i<n_pairs; ++i)
+    {
+      if (i % 8192 == 0)
+        fill_pool(gen, pool, devices);
+
+      const auto a = gen.below(pool.size());
+      const auto b = gen.below(pool.size());
+      if (!check_compare(pool[a], devices[a], pool[b], devices[b]).empty())
+        {
+          report("device_compare_func()", { pool[a], pool[b] }, check);
+          break;
+        }
+    }
+
+  for (auto device : devices)
+    g_object_unref(device);
+}
+
+TEST_F(PrimaryDeviceTest, DeviceSetsMatchReference)
+{
+  constexpr size_t MAX_DEVICES = 8;
+
+  Generator gen(seed);
+  std::vector<Spec> pool;
+  std::vector<IndicatorPowerDevice*> pool_devices;
+
+  const Check check = [](const std::vector<Spec>& specs) {
+    Devices d(specs);
+    return check_set(specs, d.get());
+  };
+
+  std::vector<Spec> specs;
+  std::vector<IndicatorPowerDevice*> devices;
+  for (size_t i=0; i<iterations; ++i)
+    {
+      if (i % 8192 == 0)
+        fill_pool(gen, pool, pool_devices);
+
+      specs.clear();
+      devices.clear();
+      const auto n = gen.below(MAX_DEVICES+1);
+      for (size_t j=0; j<n; ++j)
+        {
+          const auto k = gen.below(pool.size());
+          specs.push_back(pool[k]);
+          devices.push_back(pool_devices[k]);
+        }
+
+      if (!check_set(specs, devices).empty())
+        {
+          report("primary device selection", specs, check);
+          break;
+        }
+    }
+
+  for (auto device : pool_devices)
+    g_object_unref(device);
+}
+
+/***
+****  Make sure the harness itself can tell a wrong answer from a right one
+***/
+
+TEST_F(PrimaryDeviceTest, ShrinkFindsMinimalCase)
+{
+  // pretend that the bug is "a discharging battery under 10% with a mouse around"
+  const auto fails = [](const std::vector<Spec>& specs) {
+    bool low_battery = false;
+    bool mouse = false;
+    for (const auto& s : specs)
+      {
+        low_battery |= (s.kind == UP_DEVICE_KIND_BATTERY) && (s.state == UP_DEVICE_STATE_DISCHARGING) && (s.percentage < 10);
+        mouse |= (s.kind == UP_DEVICE_KIND_MOUSE);
+      }
+    return low_battery && mouse;
+  };
+
+  Generator gen(seed);
+  std::vector<Spec> specs;
+  while (!fails(specs))
+    specs.push_back(gen.spec());
+  for (size_t i=0; i<10; ++i)
+    specs.push_back(gen.spec());
+  ASSERT_TRUE(fails(specs));
+
+  const auto minimal = shrink(specs, [&fails](const std::vector<Spec>& s) {
+    return std::string(fails(s) ? "fails" : "");
+  });
+  ASSERT_EQ(2u, minimal.size()) << to_string(minimal);
+  EXPECT_TRUE(fails(minimal));
+  for (const auto& s : minimal)
+    {
+      EXPECT_EQ(0, s.time);
+      EXPECT_EQ(0.0, s.energy_rate);
+      EXPECT_FALSE(s.power_supply);
+      if (s.kind == UP_DEVICE_KIND_MOUSE)
+        EXPECT_EQ(UP_DEVICE_STATE_UNKNOWN, s.state);
+      else
+        EXPECT_EQ(0.0, s.percentage);
+    }
+}
+
+TEST_F(PrimaryDeviceTest, TiesFollowSortOrder)
+{
+  // these compare as "after" each other both ways,
+  // so the sort order alone decides which one wins
+  const Spec twin { UP_DEVICE_KIND_MOUSE, UP_DEVICE_STATE_DISCHARGING, 5, 600, false, 0 };
+  const std::vector<Spec> specs { twin, twin, twin };
+  Devices devices(specs);
+
+  EXPECT_LT(0, reference::compare(twin, twin));
+  EXPECT_EQ("", check_set(specs, devices.get()));
+}
+
+} // anonymous namespace
@@ -0,0 +1,361 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "glib-fixture.h"
+
+#include "process-sampler.h"
+
+#include <gtest/gtest.h>
+
+#include <glib/gstdio.h>
+
+#include <fstream>
+#include <string>
+
+#include <time.h> // clock_gettime()
+
+/***
+****
+***/
+
+class ProcessSamplerTest: public GlibFixture
+{
+  private:
+
+    typedef GlibFixture super;
+
+  protected:
+
+    char * proc_dir = nullptr;
+
+    void SetUp() override
+    {
+      super::SetUp();
+
+      proc_dir = g_dir_make_tmp ("test-process-sampler-XXXXXX", nullptr);
+      ASSERT_NE(nullptr, proc_dir);
+    }
+
+    void TearDown() override
+    {
+      char * cmd = g_strdup_printf ("rm -rf '%s'", proc_dir);
+      ASSERT_EQ(0, system(cmd));
+      g_free (cmd);
+      g_clear_pointer (&proc_dir, g_free);
+
+      super::TearDown();
+    }
+
+    // writes a fake /proc/<pid>/stat. It's rewritten in place rather
+    // than replaced so that a sampler holding the file open sees it change
+    void write_stat (int pid, const std::string& comm, guint64 utime, guint64 stime)
+    {
+      char * dir = g_strdup_printf ("%s/%d", proc_dir, pid);
+      ASSERT_EQ(0, g_mkdir_with_parents (dir, 0700));
+      std::ofstream out (std::string(dir) + "/stat", std::ios::out | std::ios::trunc);
+      out << pid << " (" << comm << ") S 1 " << pid << ' ' << pid
+          << " 0 -1 4194560 100 0 0 0 " << utime << ' ' << stime
+          << " 0 0 20 0 1 0 100 0 0\n";
+      g_free (dir);
+    }
+
+    void remove_process (int pid)
+    {
+      char * cmd = g_strdup_printf ("rm -rf '%s/%d'", proc_dir, pid);
+      ASSERT_EQ(0, system(cmd));
+      g_free (cmd);
+    }
+
+    static guint count_open_fds()
+    {
+      guint n = 0;
+      GDir * dir = g_dir_open ("/proc/self/fd", 0, nullptr);
+      while (g_dir_read_name (dir))
+        ++n;
+      g_dir_close (dir);
+      return n;
+    }
+
+    static gint64 process_cpu_usec()
+    {
+      struct timespec ts;
+      clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &ts);
+      return gint64(ts.tv_sec)*G_USEC_PER_SEC + ts.tv_nsec/1000;
+    }
+};
+
+/***
+****
+***/
+
+TEST_F(ProcessSamplerTest, MissingProcDir)
+{
+  expectLogMessage (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "*Unable to open*");
+  auto sampler = indicator_power_process_sampler_new ("/this/does/not/exist");
+  EXPECT_EQ(nullptr, sampler);
+}
+
+TEST_F(ProcessSamplerTest, FirstSampleHasNoDeltas)
+{
+  write_stat (100, "idle", 10, 10);
+  write_stat (200, "busy", 500, 100);
+
+  auto sampler = indicator_power_process_sampler_new (proc_dir);
+  ASSERT_NE(nullptr, sampler);
+  EXPECT_EQ(2u, indicator_power_process_sampler_sample (sampler));
+
+  IndicatorPowerProcessUsage top[4];
+  EXPECT_EQ(0u, indicator_power_process_sampler_get_top (sampler, top, G_N_ELEMENTS(top)));
+
+  indicator_power_process_sampler_free (sampler);
+}
+
+TEST_F(ProcessSamplerTest, DiffsAgainstPreviousSample)
+{
+  write_stat (100, "idle", 10, 10);
+  write_stat (200, "busy", 500, 100);
+  write_stat (300, "asleep", 7, 7);
+
+  auto sampler = indicator_power_process_sampler_new (proc_dir);
+  ASSERT_NE(nullptr, sampler);
+  indicator_power_process_sampler_sample (sampler);
+
+  write_stat (100, "idle", 15, 15);
+  write_stat (200, "busy", 530, 120);
+  indicator_power_process_sampler_sample (sampler);
+
+  // asleep didn't use any time, so it's not listed
+  IndicatorPowerProcessUsage top[4];
+  ASSERT_EQ(2u, indicator_power_process_sampler_get_top (sampler, top, G_N_ELEMENTS(top)));
+  EXPECT_EQ(200, top[0].pid);
+  EXPECT_STREQ("busy", top[0].name);
+  EXPECT_EQ(50u, top[0].ticks);
+  EXPECT_EQ(100, top[1].pid);
+  EXPECT_STREQ("idle", top[1].name);
+  EXPECT_EQ(10u, top[1].ticks);
+  EXPECT_GT(top[0].cpu_percent, top[1].cpu_percent);
+
+  // the next sample diffs against this one, not the first
+  write_stat (100, "idle", 115, 15);
+  indicator_power_process_sampler_sample (sampler);
+  ASSERT_EQ(1u, indicator_power_process_sampler_get_top (sampler, top, G_N_ELEMENTS(top)));
+  EXPECT_EQ(100, top[0].pid);
+  EXPECT_EQ(100u, top[0].ticks);
+
+  indicator_power_process_sampler_free (sampler);
+}
+
+TEST_F(ProcessSamplerTest, TopN)
+{
+  for (int pid=1; pid<=6; ++pid)
+    write_stat (pid, "worker", 0, 0);
+
+  auto sampler = indicator_power_process_sampler_new (proc_dir);
+  ASSERT_NE(nullptr, sampler);
+  indicator_power_process_sampler_sample (sampler);
+
+  // pid N uses N*10 ticks, but in no particular order
+  for (int pid : {4, 1, 6, 2, 5, 3})
+    write_stat (pid, "worker", pid*10, 0);
+  indicator_power_process_sampler_sample (sampler);
+
+  IndicatorPowerProcessUsage top[3];
+  ASSERT_EQ(3u, indicator_power_process_sampler_get_top (sampler, top, G_N_ELEMENTS(top)));
+  EXPECT_EQ(6, top[0].pid);
+  EXPECT_EQ(5, top[1].pid);
+  EXPECT_EQ(4, top[2].pid);
+
+  EXPECT_EQ(0u, indicator_power_process_sampler_get_top (sampler, top, 0));
+
+  indicator_power_process_sampler_free (sampler);
+}
+
+TEST_F(ProcessSamplerTest, OddNames)
+{
+  // a comm may contain spaces and parentheses, and is at most 15 chars
+  write_stat (100, "a) b (c", 0, 0);
+  write_stat (200, "a name that is far too long", 0, 0);
+
+  auto sampler = indicator_power_process_sampler_new (proc_dir);
+  ASSERT_NE(nullptr, sampler);
+  indicator_power_process_sampler_sample (sampler);
+  write_stat (100, "a) b (c", 40, 2);
+  write_stat (200, "a name that is far too long", 20, 1);
+  indicator_power_process_sampler_sample (sampler);
+
+  IndicatorPowerProcessUsage top[2];
+  ASSERT_EQ(2u, indicator_power_process_sampler_get_top (sampler, top, G_N_ELEMENTS(top)));
+  EXPECT_STREQ("a) b (c", top[0].name);
+  EXPECT_EQ(42u, top[0].ticks);
+  EXPECT_STREQ("a name that is ", top[1].name);
+  EXPECT_EQ(21u, top[1].ticks);
+
+  indicator_power_process_sampler_free (sampler);
+}
+
+TEST_F(ProcessSamplerTest, IgnoresNonProcessEntries)
+{
+  write_stat (100, "real", 0, 0);
+  ASSERT_EQ(0, g_mkdir_with_parents ((std::string(proc_dir) + "/self").c_str(), 0700));
+  ASSERT_EQ(0, g_mkdir_with_parents ((std::string(proc_dir) + "/123abc").c_str(), 0700));
+  ASSERT_EQ(0, g_mkdir_with_parents ((std::string(proc_dir) + "/sys").c_str(), 0700));
+  ASSERT_TRUE(g_file_set_contents ((std::string(proc_dir) + "/uptime").c_str(), "1.0 1.0\n", -1, nullptr));
+
+  // a pid dir whose stat can't be parsed
+  ASSERT_EQ(0, g_mkdir_with_parents ((std::string(proc_dir) + "/200").c_str(), 0700));
+  ASSERT_TRUE(g_file_set_contents ((std::string(proc_dir) + "/200/stat").c_str(), "garbage", -1, nullptr));
+
+  auto sampler = indicator_power_process_sampler_new (proc_dir);
+  ASSERT_NE(nullptr, sampler);
+  EXPECT_EQ(1u, indicator_power_process_sampler_sample (sampler));
+  indicator_power_process_sampler_free (sampler);
+}
+
+TEST_F(ProcessSamplerTest, ProcessesComeAndGo)
+{
+  write_stat (100, "stays", 0, 0);
+  write_stat (200, "exits", 0, 0);
+
+  auto sampler = indicator_power_process_sampler_new (proc_dir);
+  ASSERT_NE(nullptr, sampler);
+  EXPECT_EQ(2u, indicator_power_process_sampler_sample (sampler));
+
+  // 200 exits and 300 starts
+  remove_process (200);
+  write_stat (300, "starts", 1000, 0);
+  write_stat (100, "stays", 5, 0);
+  EXPECT_EQ(2u, indicator_power_process_sampler_sample (sampler));
+
+  // the newcomer has no baseline yet, so it isn't blamed for its whole lifetime
+  IndicatorPowerProcessUsage top[4];
+  ASSERT_EQ(1u, indicator_power_process_sampler_get_top (sampler, top, G_N_ELEMENTS(top)));
+  EXPECT_EQ(100, top[0].pid);
+
+  write_stat (300, "starts", 1030, 0);
+  indicator_power_process_sampler_sample (sampler);
+  ASSERT_EQ(1u, indicator_power_process_sampler_get_top (sampler, top, G_N_ELEMENTS(top)));
+  EXPECT_EQ(300, top[0].pid);
+  EXPECT_EQ(30u, top[0].ticks);
+
+  indicator_power_process_sampler_free (sampler);
+}
+
+TEST_F(ProcessSamplerTest, ClosesItsFds)
+{
+  for (int pid=1; pid<=20; ++pid)
+    write_stat (pid, "worker", 0, 0);
+
+  const auto fds_before = count_open_fds();
+
+  auto sampler = indicator_power_process_sampler_new (proc_dir);
+  ASSERT_NE(nullptr, sampler);
+  indicator_power_process_sampler_sample (sampler);
+
+  // the stat files are kept open between samples...
+  EXPECT_GE(count_open_fds(), fds_before + 20);
+
+  // ...until their processes exit...
+  for (int pid=11; pid<=20; ++pid)
+    remove_process (pid);
+  indicator_power_process_sampler_sample (sampler);
+  EXPECT_LT(count_open_fds(), fds_before + 20);
+
+  // ...or the sampler is freed
+  indicator_power_process_sampler_free (sampler);
+  EXPECT_EQ(fds_before, count_open_fds());
+}
+
+TEST_F(ProcessSamplerTest, ShedDropsEverything)
+{
+  for (int pid=1; pid<=20; ++pid)
+    write_stat (pid, "worker", 0, 0);
+
+  const auto fds_before = count_open_fds();
+
+  auto sampler = indicator_power_process_sampler_new (proc_dir);
+  ASSERT_NE(nullptr, sampler);
+  indicator_power_process_sampler_sample (sampler);
+  write_stat (5, "worker", 50, 0);
+  indicator_power_process_sampler_sample (sampler);
+
+  IndicatorPowerProcessUsage top[4];
+  ASSERT_EQ(1u, indicator_power_process_sampler_get_top (sampler, top, G_N_ELEMENTS(top)));
+
+  // shedding closes the stat files and forgets the deltas
+  indicator_power_process_sampler_shed (sampler);
+  EXPECT_EQ(fds_before + 1, count_open_fds()); // the /proc dir itself
+  EXPECT_EQ(0u, indicator_power_process_sampler_get_top (sampler, top, G_N_ELEMENTS(top)));
+
+  // the next sample is a new baseline, and the one after that diffs against it
+  write_stat (5, "worker", 80, 0);
+  EXPECT_EQ(20u, indicator_power_process_sampler_sample (sampler));
+  EXPECT_EQ(0u, indicator_power_process_sampler_get_top (sampler, top, G_N_ELEMENTS(top)));
+  write_stat (5, "worker", 90, 0);
+  indicator_power_process_sampler_sample (sampler);
+  ASSERT_EQ(1u, indicator_power_process_sampler_get_top (sampler, top, G_N_ELEMENTS(top)));
+  EXPECT_EQ(5, top[0].pid);
+  EXPECT_EQ(10u, top[0].ticks);
+
+  indicator_power_process_sampler_free (sampler);
+  EXPECT_EQ(fds_before, count_open_fds());
+}
+
+/**
+ * Benchmark the sampler's own overhead against the real /proc.
+ * The service samples every couple of seconds while the top consumers
+ * section is live, and that shouldn't cost more than 1% of a CPU.
+ *
+ * CPU time on a shared build host is too noisy to fail on, so the
+ * numbers are only reported unless INDICATOR_POWER_TEST_BENCHMARK is set.
+ */
+TEST_F(ProcessSamplerTest, Overhead)
+{
+  constexpr int interval_usec = 2 * G_USEC_PER_SEC;
+  constexpr int budget_usec = interval_usec / 100;
+  constexpr int n_samples = 50;
+
+  auto sampler = indicator_power_process_sampler_new (nullptr);
+  ASSERT_NE(nullptr, sampler);
+
+  // the first sample opens every stat file, so time it separately
+  auto start = process_cpu_usec();
+  const auto n_processes = indicator_power_process_sampler_sample (sampler);
+  const auto first_usec = process_cpu_usec() - start;
+
+  start = process_cpu_usec();
+  for (int i=0; i<n_samples; ++i)
+    indicator_power_process_sampler_sample (sampler);
+  const auto steady_usec = (process_cpu_usec() - start) / n_samples;
+
+  IndicatorPowerProcessUsage top[5];
+  start = process_cpu_usec();
+  for (int i=0; i<n_samples; ++i)
+    indicator_power_process_sampler_get_top (sampler, top, G_N_ELEMENTS(top));
+  const auto top_usec = (process_cpu_usec() - start) / n_samples;
+
+  indicator_power_process_sampler_free (sampler);
+
+  RecordProperty("processes", int(n_processes));
+  RecordProperty("first_sample_usec", int(first_usec));
+  RecordProperty("sample_usec", int(steady_usec));
+  RecordProperty("get_top_usec", int(top_usec));
+  g_message("%u processes: first sample %" G_GINT64_FORMAT " usec, then %" G_GINT64_FORMAT " usec per sample (budget %d)",
+            n_processes, first_usec, steady_usec, budget_usec);
+
+  EXPECT_GT(n_processes, 0u);
+  if (g_getenv("INDICATOR_POWER_TEST_BENCHMARK") != nullptr)
+    EXPECT_LT(steady_usec + top_usec, budget_usec);
+}
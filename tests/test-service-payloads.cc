@@ -0,0 +1,237 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "glib-fixture.h"
+
+#include "device.h"
+#include "device-provider-mock.h"
+#include "notifier.h"
+#include "service.h"
+
+#include <gtest/gtest.h>
+
+#include <gio/gio.h>
+
+#include <string>
+#include <vector>
+
+/***
+****  The service with threaded-payloads enabled, as main() runs it
+***/
+
+class ServicePayloadsTest: public GlibFixture
+{
+  private:
+
+    typedef GlibFixture super;
+
+  protected:
+
+    GTestDBus * test_bus {};
+    IndicatorPowerNotifier * notifier {};
+    IndicatorPowerDeviceProvider * provider {};
+    IndicatorPowerDevice * battery {};
+    IndicatorPowerService * service {};
+
+    void SetUp() override
+    {
+      super::SetUp();
+
+      // the service and its helpers use both buses
+      test_bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+      g_test_dbus_up(test_bus);
+      g_setenv("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address(test_bus), TRUE);
+
+      battery = indicator_power_device_new("/org/freedesktop/UPower/devices/battery_BAT0",
+                                           UP_DEVICE_KIND_BATTERY,
+                                           50.0,
+                                           UP_DEVICE_STATE_DISCHARGING,
+                                           60*60*3,
+                                           TRUE);
+      provider = indicator_power_device_provider_mock_new();
+      notifier = indicator_power_notifier_new();
+      service = indicator_power_service_new(nullptr, notifier);
+      g_object_set(service, "threaded-payloads", TRUE, nullptr);
+      wait_msec();
+    }
+
+    void TearDown() override
+    {
+      g_clear_object(&service);
+      g_clear_object(&notifier);
+      g_clear_object(&provider);
+      g_clear_object(&battery);
+
+      // let the scaffolding shut down before tearing down the bus
+      wait_msec(100);
+      g_test_dbus_down(test_bus);
+      g_clear_object(&test_bus);
+      g_unsetenv("DBUS_SYSTEM_BUS_ADDRESS");
+
+      super::TearDown();
+    }
+
+    static std::string get_accessible_desc(GVariant * header_state)
+    {
+      const char * desc {};
+      return g_variant_lookup(header_state, "accessible-desc", "&s", &desc) ? desc : "";
+    }
+
+    std::string header_accessible_desc()
+    {
+      auto state = g_action_group_get_action_state(indicator_power_service_get_action_group(service), "_header");
+      const auto desc = get_accessible_desc(state);
+      g_variant_unref(state);
+      return desc;
+    }
+
+    std::string expected_accessible_desc()
+    {
+      auto str = indicator_power_device_get_accessible_title(battery, false, false, false);
+      const std::string desc {str};
+      g_free(str);
+      return desc;
+    }
+
+    std::vector<std::string> desktop_device_labels()
+    {
+      std::vector<std::string> labels;
+
+      auto menu = indicator_power_service_get_menu_model(service, "desktop");
+      auto submenu = g_menu_model_get_item_link(menu, 0, G_MENU_LINK_SUBMENU);
+      auto section = g_menu_model_get_item_link(submenu, 0, G_MENU_LINK_SECTION);
+      for (int i=0, n=g_menu_model_get_n_items(section); i<n; ++i)
+        {
+          gchar * label {};
+          if (g_menu_model_get_item_attribute(section, i, G_MENU_ATTRIBUTE_LABEL, "s", &label))
+            labels.push_back(label);
+          g_free(label);
+        }
+      g_object_unref(section);
+      g_object_unref(submenu);
+
+      return labels;
+    }
+
+    std::string expected_device_label()
+    {
+      auto str = indicator_power_device_get_readable_text(battery);
+      const std::string label {str};
+      g_free(str);
+      return label;
+    }
+};
+
+/***
+****
+***/
+
+TEST_F(ServicePayloadsTest, SwapsInHeaderAndDevices)
+{
+  EXPECT_EQ("", header_accessible_desc());
+  EXPECT_TRUE(desktop_device_labels().empty());
+
+  indicator_power_service_set_device_provider(service, provider);
+  indicator_power_device_provider_add_device(INDICATOR_POWER_DEVICE_PROVIDER_MOCK(provider), battery);
+
+  // the payloads are built in a worker thread and only
+  // swapped in from the main loop, so nothing has changed yet
+  EXPECT_EQ("", header_accessible_desc());
+  EXPECT_TRUE(desktop_device_labels().empty());
+
+  const auto expected_desc = expected_accessible_desc();
+  EXPECT_TRUE(wait_for([this, &expected_desc](){return header_accessible_desc() == expected_desc;}));
+  EXPECT_EQ(std::vector<std::string>{expected_device_label()}, desktop_device_labels());
+}
+
+TEST_F(ServicePayloadsTest, DropsStalePayloads)
+{
+  indicator_power_service_set_device_provider(service, provider);
+  indicator_power_device_provider_add_device(INDICATOR_POWER_DEVICE_PROVIDER_MOCK(provider), battery);
+  const auto desc_50 = expected_accessible_desc();
+  ASSERT_TRUE(wait_for([this, &desc_50](){return header_accessible_desc() == desc_50;}));
+
+  std::vector<std::string> seen;
+  const auto tag = g_signal_connect(indicator_power_service_get_action_group(service),
+                                    "action-state-changed::_header",
+                                    G_CALLBACK(+[](GActionGroup*, const gchar*, GVariant * state, gpointer gseen){
+                                      static_cast<std::vector<std::string>*>(gseen)->push_back(get_accessible_desc(state));
+                                    }), &seen);
+
+  // queue two requests without letting the main loop run in between,
+  // so the first one's result is stale by the time it's ready
+  g_object_set(battery, INDICATOR_POWER_DEVICE_PERCENTAGE, 40.0, nullptr);
+  const auto desc_40 = expected_accessible_desc();
+  g_object_set(battery, INDICATOR_POWER_DEVICE_PERCENTAGE, 30.0, nullptr);
+  const auto desc_30 = expected_accessible_desc();
+  ASSERT_NE(desc_40, desc_30);
+
+  EXPECT_TRUE(wait_for([this, &desc_30](){return header_accessible_desc() == desc_30;}));
+  wait_msec(200); // give a late, stale payload the chance to clobber it
+
+  EXPECT_EQ(std::vector<std::string>{desc_30}, seen);
+  EXPECT_EQ(desc_30, header_accessible_desc());
+  EXPECT_EQ(std::vector<std::string>{expected_device_label()}, desktop_device_labels());
+
+  g_signal_handler_disconnect(indicator_power_service_get_action_group(service), tag);
+}
+
+TEST_F(ServicePayloadsTest, ExportsDiagnostics)
+{
+  GDBusConnection * bus {};
+  ASSERT_TRUE(wait_for([this, &bus](){g_clear_object(&bus); g_object_get(service, "bus", &bus, nullptr); return bus != nullptr;}));
+
+  // the service answers from this main loop, so the call can't block it
+  struct Data {
+    GMainLoop * loop;
+    GVariant * reply;
+    GError * error;
+  } data {loop, nullptr, nullptr};
+  g_dbus_connection_call(bus,
+                         g_dbus_connection_get_unique_name(bus),
+                         "/org/ayatana/indicator/power/Diagnostics",
+                         "org.freedesktop.DBus.Properties",
+                         "GetAll",
+                         g_variant_new("(s)", "org.ayatana.indicator.power.Diagnostics"),
+                         G_VARIANT_TYPE("(a{sv})"),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         -1,
+                         nullptr,
+                         [](GObject * o, GAsyncResult * res, gpointer gdata){
+                           auto data = static_cast<Data*>(gdata);
+                           data->reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(o), res, &data->error);
+                           g_main_loop_quit(data->loop);
+                         },
+                         &data);
+  g_main_loop_run(loop);
+  g_assert_no_error(data.error);
+  auto reply = data.reply;
+  ASSERT_NE(nullptr, reply);
+
+  // nothing has been rate-limited or shed yet
+  auto all = g_variant_get_child_value(reply, 0);
+  auto drops = g_variant_lookup_value(all, "RateLimitDrops", G_VARIANT_TYPE("a{su}"));
+  ASSERT_NE(nullptr, drops);
+  EXPECT_EQ(0u, g_variant_n_children(drops));
+  guint64 bytes_released {G_MAXUINT64};
+  EXPECT_TRUE(g_variant_lookup(all, "BytesReleased", "t", &bytes_released));
+  EXPECT_EQ(0u, bytes_released);
+
+  g_variant_unref(drops);
+  g_variant_unref(all);
+  g_variant_unref(reply);
+  g_object_unref(bus);
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "glib-fixture.h"
+
+#include "dbus-shared.h"
+#include "device-provider-upower.h"
+#include "notifier.h"
+#include "service.h"
+
+#include <gtest/gtest.h>
+
+#include <gio/gio.h>
+
+#include <cstdio>
+#include <unistd.h>
+
+/***
+****  How long the service takes to come up, and how much memory it needs
+***/
+
+class ServiceStartupTest: public GlibFixture
+{
+  private:
+
+    typedef GlibFixture super;
+
+  protected:
+
+    GTestDBus * test_bus {};
+
+    void SetUp() override
+    {
+      super::SetUp();
+
+      // the service and its helpers use both buses
+      test_bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+      g_test_dbus_up(test_bus);
+      g_setenv("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address(test_bus), TRUE);
+      g_unsetenv("INDICATOR_POWER_TESTING");
+    }
+
+    void TearDown() override
+    {
+      // let the scaffolding shut down before tearing down the bus
+      wait_msec(100);
+      g_test_dbus_down(test_bus);
+      g_clear_object(&test_bus);
+      g_unsetenv("DBUS_SYSTEM_BUS_ADDRESS");
+
+      super::TearDown();
+    }
+
+    // the process's resident set size in bytes, or -1 on error
+    static gint64 resident_bytes()
+    {
+      gchar * contents {};
+      gint64 pages {-1};
+
+      if (g_file_get_contents("/proc/self/statm", &contents, nullptr, nullptr))
+        {
+          if (sscanf(contents, "%*s %" G_GINT64_FORMAT, &pages) != 1)
+            pages = -1;
+          g_free(contents);
+        }
+
+      return pages < 0 ? -1 : pages * sysconf(_SC_PAGESIZE);
+    }
+};
+
+/***
+****
+***/
+
+/**
+ * Starts the service the way main() does without INDICATOR_POWER_TESTING,
+ * and reports how long it takes to export its objects and own its name,
+ * and how much the resident set grew meanwhile.
+ *
+ * The numbers are recorded as test properties so that runs can be
+ * compared, e.g. with --gtest_output=xml before and after a change.
+ * They depend too much on the host to fail on, except when
+ * INDICATOR_POWER_TEST_BENCHMARK is set.
+ */
+TEST_F(ServiceStartupTest, TimeAndMemory)
+{
+  constexpr gint64 budget_usec {500000};
+  constexpr gint64 budget_rss_growth_kib {4096};
+
+  const auto rss_before = resident_bytes();
+  const auto start = g_get_monotonic_time();
+
+  auto notifier = indicator_power_notifier_new();
+  auto service = indicator_power_service_new(nullptr, notifier);
+  g_object_set(service, "threaded-payloads", TRUE, nullptr);
+  auto provider = indicator_power_device_provider_upower_new();
+  indicator_power_service_set_device_provider(service, provider);
+  const auto constructed_usec = g_get_monotonic_time() - start;
+
+  GDBusConnection * bus {};
+  EXPECT_TRUE(wait_for([service, &bus](){
+    g_clear_object(&bus);
+    g_object_get(service, "bus", &bus, nullptr);
+    return bus != nullptr;
+  }, 5000));
+  const auto exported_usec = g_get_monotonic_time() - start;
+
+  ASSERT_NE(nullptr, bus);
+  EXPECT_TRUE(wait_for_name_owned(bus, BUS_NAME, 5000));
+  const auto owned_usec = g_get_monotonic_time() - start;
+
+  // let the first round of payloads land before measuring memory
+  wait_msec(100);
+  const auto rss_after = resident_bytes();
+
+  RecordProperty("constructed_usec", int(constructed_usec));
+  RecordProperty("exported_usec", int(exported_usec));
+  RecordProperty("name_owned_usec", int(owned_usec));
+  RecordProperty("rss_growth_kib", int((rss_after - rss_before) / 1024));
+  RecordProperty("rss_kib", int(rss_after / 1024));
+  g_message("constructed in %" G_GINT64_FORMAT " usec, exported in %" G_GINT64_FORMAT " usec, "
+            "name owned in %" G_GINT64_FORMAT " usec (budget %" G_GINT64_FORMAT "); "
+            "RSS %" G_GINT64_FORMAT " KiB (+%" G_GINT64_FORMAT " KiB, budget %" G_GINT64_FORMAT ")",
+            constructed_usec, exported_usec, owned_usec, budget_usec,
+            rss_after / 1024, (rss_after - rss_before) / 1024, budget_rss_growth_kib);
+
+  EXPECT_GT(rss_before, 0);
+  EXPECT_GT(rss_after, 0);
+  if (g_getenv("INDICATOR_POWER_TEST_BENCHMARK") != nullptr)
+    {
+      EXPECT_LT(owned_usec, budget_usec);
+      EXPECT_LT((rss_after - rss_before) / 1024, budget_rss_growth_kib);
+    }
+
+  g_object_unref(bus);
+  g_object_unref(service);
+  g_object_unref(provider);
+  g_object_unref(notifier);
+}
@@ -0,0 +1,434 @@
+/*
+ * Copyright 2026 Ayatana Indicators
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "glib-fixture.h"
+
+#include "device.h"
+#include "suspend-monitor.h"
+
+#include <gtest/gtest.h>
+
+#include <gio/gio.h>
+#include <gio/gunixfdlist.h>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+/***
+****  A fake org.freedesktop.login1 that hands out inhibitor fds
+****  and emits PrepareForSleep on demand
+***/
+
+class FakeLogind
+{
+  public:
+
+    static constexpr char const * BUS_NAME {"org.freedesktop.login1"};
+    static constexpr char const * PATH     {"/org/freedesktop/login1"};
+    static constexpr char const * IFACE    {"org.freedesktop.login1.Manager"};
+
+    explicit FakeLogind (const char * address)
+    {
+      const gchar introspection_xml[] =
+        "<node>"
+        "  <interface name='org.freedesktop.login1.Manager'>"
+        "    <method name='Inhibit'>"
+        "      <arg name='what' type='s' direction='in' />"
+        "      <arg name='who' type='s' direction='in' />"
+        "      <arg name='why' type='s' direction='in' />"
+        "      <arg name='mode' type='s' direction='in' />"
+        "      <arg name='fd' type='h' direction='out' />"
+        "    </method>"
+        "    <signal name='PrepareForSleep'>"
+        "      <arg name='start' type='b' />"
+        "    </signal>"
+        "  </interface>"
+        "</node>";
+
+      node_info_ = g_dbus_node_info_new_for_xml(introspection_xml, nullptr);
+      g_assert(node_info_ != nullptr);
+
+      GError * error {};
+      connection_ = g_dbus_connection_new_for_address_sync(
+        address,
+        GDBusConnectionFlags(G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT|
+                             G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION),
+        nullptr, nullptr, &error);
+      g_assert_no_error(error);
+
+      static const GDBusInterfaceVTable vtable = { on_method_call, nullptr, nullptr };
+      registration_id_ = g_dbus_connection_register_object(connection_,
+                                                           PATH,
+                                                           node_info_->interfaces[0],
+                                                           &vtable,
+                                                           this, nullptr, &error);
+      g_assert_no_error(error);
+
+      own_id_ = g_bus_own_name_on_connection(connection_,
+                                             BUS_NAME,
+                                             G_BUS_NAME_OWNER_FLAGS_NONE,
+                                             nullptr, nullptr, nullptr, nullptr);
+    }
+
+    ~FakeLogind()
+    {
+      for (const auto fd : inhibitors_)
+        close(fd);
+
+      g_bus_unown_name(own_id_);
+      g_dbus_connection_unregister_object(connection_, registration_id_);
+      g_dbus_connection_close_sync(connection_, nullptr, nullptr);
+      g_clear_object(&connection_);
+      g_dbus_node_info_unref(node_info_);
+    }
+
+    GDBusConnection* connection() { return connection_; }
+
+    void prepare_for_sleep (bool start)
+    {
+      GError * error {};
+      g_dbus_connection_emit_signal(connection_,
+                                    nullptr,
+                                    PATH,
+                                    IFACE,
+                                    "PrepareForSleep",
+                                    g_variant_new("(b)", gboolean(start)),
+                                    &error);
+      g_assert_no_error(error);
+    }
+
+    size_t n_inhibit_calls() const { return inhibitors_.size(); }
+
+    // how many of the inhibitors we've handed out are still open
+    size_t n_held() const
+    {
+      size_t n {};
+
+      for (const auto fd : inhibitors_)
+        {
+          struct pollfd pfd { fd, POLLIN, 0 };
+          if ((poll(&pfd, 1, 0) == 0) || !(pfd.revents & POLLHUP))
+            ++n;
+        }
+
+      return n;
+    }
+
+  private:
+
+    GDBusNodeInfo * node_info_ {};
+    GDBusConnection * connection_ {};
+    guint registration_id_ {};
+    guint own_id_ {};
+
+    // the read ends of the pipes whose write ends we handed out.
+    // They hang up once the client closes its inhibitor.
+    std::vector<int> inhibitors_;
+
+    static void on_method_call (GDBusConnection *,
+                                const gchar *,
+                                const gchar *,
+                                const gchar *,
+                                const gchar * method_name,
+                                GVariant * parameters,
+                                GDBusMethodInvocation * invocation,
+                                gpointer gself)
+    {
+      auto self = static_cast<FakeLogind*>(gself);
+
+      g_assert_cmpstr(method_name, ==, "Inhibit");
+
+      const gchar * what {};
+      const gchar * mode {};
+      g_variant_get(parameters, "(&s&s&s&s)", &what, nullptr, nullptr, &mode);
+      EXPECT_STREQ("sleep", what);
+      EXPECT_STREQ("delay", mode);
+
+      int fds[2];
+      g_assert(pipe(fds) == 0);
+      self->inhibitors_.push_back(fds[0]);
+
+      auto fd_list = g_unix_fd_list_new();
+      g_unix_fd_list_append(fd_list, fds[1], nullptr);
+      close(fds[1]); // the list has its own copy
+      g_dbus_method_invocation_return_value_with_unix_fd_list(invocation,
+                                                              g_variant_new("(h)", 0),
+                                                              fd_list);
+      g_object_unref(fd_list);
+    }
+};
+
+/***
+****
+***/
+
+class SuspendMonitorTest: public GlibFixture
+{
+  private:
+
+    typedef GlibFixture super;
+
+  protected:
+
+    GTestDBus * test_bus {};
+    FakeLogind * logind {};
+    std::vector<IndicatorPowerDevice*> devices;
+    int history_changed_count {};
+
+    void SetUp() override
+    {
+      super::SetUp();
+
+      // the monitor talks to logind on the system bus
+      test_bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+      g_test_dbus_up(test_bus);
+      g_setenv("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address(test_bus), TRUE);
+
+      logind = new FakeLogind(g_test_dbus_get_bus_address(test_bus));
+      ASSERT_NAME_OWNED_EVENTUALLY(logind->connection(), FakeLogind::BUS_NAME);
+    }
+
+    void TearDown() override
+    {
+      for (auto device : devices)
+        g_object_unref(device);
+      devices.clear();
+
+      delete logind;
+      logind = nullptr;
+
+      // let the scaffolding shut down before tearing down the bus
+      wait_msec(100);
+      g_test_dbus_down(test_bus);
+      g_clear_object(&test_bus);
+      g_unsetenv("DBUS_SYSTEM_BUS_ADDRESS");
+
+      super::TearDown();
+    }
+
+    IndicatorPowerSuspendMonitor* create_monitor(guint min_sleep_seconds=0)
+    {
+      auto o = g_object_new(INDICATOR_TYPE_POWER_SUSPEND_MONITOR,
+                            INDICATOR_POWER_SUSPEND_MONITOR_PROP_MIN_SLEEP_SECONDS, min_sleep_seconds,
+                            nullptr);
+      auto monitor = INDICATOR_POWER_SUSPEND_MONITOR(o);
+
+      g_signal_connect(monitor, INDICATOR_POWER_SUSPEND_MONITOR_SIGNAL_HISTORY_CHANGED,
+                       G_CALLBACK(+[](IndicatorPowerSuspendMonitor*, gpointer gself){
+                         static_cast<SuspendMonitorTest*>(gself)->history_changed_count++;
+                       }), this);
+
+      // wait for it to connect and take its first inhibitor
+      EXPECT_TRUE(wait_for([this](){return logind->n_held() == 1;}));
+
+      return monitor;
+    }
+
+    IndicatorPowerDevice* battery(double percentage, UpDeviceState state=UP_DEVICE_STATE_DISCHARGING)
+    {
+      auto device = indicator_power_device_new("/org/freedesktop/UPower/devices/BAT0",
+                                               UP_DEVICE_KIND_BATTERY,
+                                               percentage,
+                                               state,
+                                               60*60,
+                                               TRUE);
+      devices.push_back(device);
+      return device;
+    }
+
+    void sleep_and_wake()
+    {
+      const auto n_calls = logind->n_inhibit_calls();
+
+      logind->prepare_for_sleep(true);
+      EXPECT_TRUE(wait_for([this](){return logind->n_held() == 0;}));
+      wait_msec(20);
+      logind->prepare_for_sleep(false);
+      EXPECT_TRUE(wait_for([this, n_calls](){return logind->n_inhibit_calls() == n_calls+1;}));
+      EXPECT_TRUE(wait_for([this](){return logind->n_held() == 1;}));
+    }
+
+    static guint history_size(IndicatorPowerSuspendMonitor* monitor)
+    {
+      guint n {};
+      indicator_power_suspend_monitor_get_history(monitor, &n);
+      return n;
+    }
+};
+
+/***
+****
+***/
+
+TEST_F(SuspendMonitorTest, HoldsInhibitorOnlyWhileAwake)
+{
+  auto monitor = create_monitor();
+  EXPECT_EQ(1u, logind->n_inhibit_calls());
+
+  logind->prepare_for_sleep(true);
+  EXPECT_TRUE(wait_for([this](){return logind->n_held() == 0;}));
+  EXPECT_EQ(1u, logind->n_inhibit_calls());
+
+  logind->prepare_for_sleep(false);
+  EXPECT_TRUE(wait_for([this](){return logind->n_held() == 1;}));
+  EXPECT_EQ(2u, logind->n_inhibit_calls());
+
+  g_object_unref(monitor);
+  EXPECT_EQ(0u, logind->n_held());
+}
+
+TEST_F(SuspendMonitorTest, RecordsDrainAcrossSleep)
+{
+  auto monitor = create_monitor();
+  indicator_power_suspend_monitor_set_battery(monitor, battery(80));
+
+  const auto before = g_get_real_time();
+  sleep_and_wake();
+  EXPECT_EQ(0u, history_size(monitor));
+
+  // the first fresh percentage after waking completes the record
+  indicator_power_suspend_monitor_set_battery(monitor, battery(75));
+  const auto after = g_get_real_time();
+  EXPECT_EQ(1, history_changed_count);
+
+  guint n {};
+  auto history = indicator_power_suspend_monitor_get_history(monitor, &n);
+  ASSERT_EQ(1u, n);
+  EXPECT_LE(before, history[0].slept_at);
+  EXPECT_LT(history[0].slept_at, history[0].woke_at);
+  EXPECT_GE(after, history[0].woke_at);
+  EXPECT_LT(0, history[0].duration);
+  EXPECT_GE(after - before, history[0].duration);
+  EXPECT_EQ(80.0, history[0].percentage_before);
+  EXPECT_EQ(75.0, history[0].percentage_after);
+
+  const double hours = history[0].duration / (3600.0 * G_USEC_PER_SEC);
+  EXPECT_NEAR(5 / hours, indicator_power_suspend_record_get_drain_rate(&history[0]), 1e-6 * (5 / hours));
+
+  // later updates don't add more records
+  indicator_power_suspend_monitor_set_battery(monitor, battery(74));
+  EXPECT_EQ(1u, history_size(monitor));
+
+  g_object_unref(monitor);
+}
+
+TEST_F(SuspendMonitorTest, WaitsForFreshPercentage)
+{
+  auto monitor = create_monitor();
+  indicator_power_suspend_monitor_set_battery(monitor, battery(50));
+  sleep_and_wake();
+
+  // an unchanged percentage may be a stale pre-suspend value
+  indicator_power_suspend_monitor_set_battery(monitor, battery(50));
+  indicator_power_suspend_monitor_set_battery(monitor, nullptr);
+  EXPECT_EQ(0u, history_size(monitor));
+
+  indicator_power_suspend_monitor_set_battery(monitor, battery(49));
+  EXPECT_EQ(1u, history_size(monitor));
+
+  g_object_unref(monitor);
+}
+
+/* the wake side of the record is timed when the battery reports,
+   not when logind says the system is back */
+TEST_F(SuspendMonitorTest, TimesWakeFromSample)
+{
+  constexpr int delay_msec {300};
+
+  auto monitor = create_monitor();
+  indicator_power_suspend_monitor_set_battery(monitor, battery(50));
+  sleep_and_wake();
+
+  wait_msec(delay_msec);
+  const auto before_sample = g_get_real_time();
+  indicator_power_suspend_monitor_set_battery(monitor, battery(49));
+  const auto after_sample = g_get_real_time();
+
+  guint n {};
+  auto history = indicator_power_suspend_monitor_get_history(monitor, &n);
+  ASSERT_EQ(1u, n);
+  EXPECT_LE(before_sample, history[0].woke_at);
+  EXPECT_GE(after_sample, history[0].woke_at);
+  EXPECT_LE(gint64(delay_msec) * 1000, history[0].duration);
+
+  g_object_unref(monitor);
+}
+
+TEST_F(SuspendMonitorTest, IgnoresSleepsNotOnBattery)
+{
+  auto monitor = create_monitor();
+
+  indicator_power_suspend_monitor_set_battery(monitor, battery(50, UP_DEVICE_STATE_CHARGING));
+  sleep_and_wake();
+  indicator_power_suspend_monitor_set_battery(monitor, battery(60, UP_DEVICE_STATE_CHARGING));
+
+  indicator_power_suspend_monitor_set_battery(monitor, nullptr);
+  sleep_and_wake();
+  indicator_power_suspend_monitor_set_battery(monitor, battery(60));
+
+  EXPECT_EQ(0u, history_size(monitor));
+  EXPECT_EQ(0, history_changed_count);
+
+  g_object_unref(monitor);
+}
+
+TEST_F(SuspendMonitorTest, IgnoresShortSleeps)
+{
+  auto monitor = create_monitor(300);
+
+  indicator_power_suspend_monitor_set_battery(monitor, battery(50));
+  sleep_and_wake();
+  indicator_power_suspend_monitor_set_battery(monitor, battery(49));
+
+  EXPECT_EQ(0u, history_size(monitor));
+  EXPECT_EQ(0, history_changed_count);
+
+  g_object_unref(monitor);
+}
+
+TEST_F(SuspendMonitorTest, KeepsOnlyRecentHistory)
+{
+  constexpr int n_sleeps = INDICATOR_POWER_SUSPEND_MONITOR_HISTORY_SIZE + 4;
+
+  auto monitor = create_monitor();
+
+  for (int i=0; i<n_sleeps; ++i)
+    {
+      indicator_power_suspend_monitor_set_battery(monitor, battery(100-i));
+      sleep_and_wake();
+    }
+  indicator_power_suspend_monitor_set_battery(monitor, battery(100-n_sleeps));
+  EXPECT_EQ(n_sleeps, history_changed_count);
+
+  guint n {};
+  auto history = indicator_power_suspend_monitor_get_history(monitor, &n);
+  ASSERT_EQ(guint(INDICATOR_POWER_SUSPEND_MONITOR_HISTORY_SIZE), n);
+
+  // oldest first, and the oldest ones were dropped
+  for (guint i=0; i<n; ++i)
+    {
+      const double expected = 100 - (n_sleeps - int(n)) - int(i);
+      EXPECT_EQ(expected, history[i].percentage_before);
+      EXPECT_EQ(expected-1, history[i].percentage_after);
+      if (i > 0)
+        EXPECT_LT(history[i-1].slept_at, history[i].slept_at);
+    }
+
+  g_object_unref(monitor);
+}